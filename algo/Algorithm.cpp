@@ -2,7 +2,7 @@
 
 Algorithm::Algorithm(std::string_view name, bool canDoLiveUpdate)
     : m_name(name.begin(), name.end()), m_canDoLiveUpdate(canDoLiveUpdate),
-    m_implSet(false), m_runtime(0.0), m_iterations(1)
+    m_implSet(false), m_activeImpl(CPU), m_runtime(0.0), m_iterations(1)
 {
 
 }
@@ -13,7 +13,9 @@ public:
         CPU,
         GPU,
         OPENCV_CPU,
-        OPENCV_GPU
+        OPENCV_GPU,
+        CPU_EXACT_COVER,
+        CPU_BITBOARD
     };
 
 public:
@@ -1,12 +1,12 @@
 #include "Container.h"
 
-ContainerSpecification::ContainerSpecification()
+ContainerSpecification::ContainerSpecification() : m_optional(false)
 {
 
 }
 
-ContainerSpecification::ContainerSpecification(std::string name, ContainerSpecification::Type type, ContainerSpecification::DataType dataType)
- : m_name(name), m_dataType(dataType), m_type(type)
+ContainerSpecification::ContainerSpecification(std::string name, ContainerSpecification::Type type, ContainerSpecification::DataType dataType, bool optional)
+ : m_name(name), m_dataType(dataType), m_type(type), m_optional(optional)
 {
 
 }
@@ -41,6 +41,16 @@ void ContainerSpecification::setDataType(const DataType &dataType)
     m_dataType = dataType;
 }
 
+bool ContainerSpecification::optional() const
+{
+    return m_optional;
+}
+
+void ContainerSpecification::setOptional(bool optional)
+{
+    m_optional = optional;
+}
+
 Container::Container()
 {
 
@@ -22,7 +22,7 @@ public:
     };
 
     ContainerSpecification();
-    ContainerSpecification(std::string name, Type type, DataType dataType = GENERIC);
+    ContainerSpecification(std::string name, Type type, DataType dataType = GENERIC, bool optional = false);
 
     std::string name() const;
     void setName(const std::string &name);
@@ -33,10 +33,18 @@ public:
     DataType dataType() const;
     void setDataType(const DataType &dataType);
 
+    /**
+     * @brief optional the argument may stay unbound, optional arguments follow the required ones,
+     *        so an unbound one leaves all following arguments unbound too
+     */
+    bool optional() const;
+    void setOptional(bool optional);
+
 private:
     std::string m_name;
     DataType m_dataType;
     Type m_type;
+    bool m_optional;
 };
 
 class Container
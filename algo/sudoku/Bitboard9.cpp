@@ -0,0 +1,343 @@
+#include "Bitboard9.h"
+
+#include <array>
+#include <bit>
+
+namespace
+{
+constexpr uint32_t BandMask = 0x7FFFFFF;
+constexpr uint32_t RowMask = 0x1FF;
+// bits 0, 9 and 18, the column at offset 0 of a band
+constexpr uint32_t ColMask = 0x40201;
+// the 3x3 box at offset 0 of a band
+constexpr uint32_t BoxMask = 0x1C0E07;
+
+// bits of State::changed, the boards of band 0 and of digit 1
+constexpr uint32_t BandBoards = 0x1249249;
+constexpr uint32_t DigitBoards = 0x7;
+
+/// present mini rows (bit 3 * row + box) of a band, per 9 bit row: bit box set if the row has a cell in it
+constexpr std::array<uint8_t, 512> MiniRows = []
+{
+    std::array<uint8_t, 512> t{};
+    for (uint32_t row = 0; row < 512; ++row)
+    {
+        t[row] = uint8_t((row & 0x7 ? 1 : 0) | (row & 0x38 ? 2 : 0) | (row & 0x1C0 ? 4 : 0));
+    }
+    return t;
+}();
+
+/**
+ * Cells of a band still usable for a digit by the set of its present mini rows.
+ * Every row and box takes the digit once, so the mini rows holding it are one of the
+ * 6 row to box permutations. The mask keeps the mini rows of all permutations that are
+ * fully present, 0 if there is none.
+ */
+constexpr std::array<uint32_t, 512> LockedCells = []
+{
+    constexpr int permutations[6][3] = {{0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+
+    std::array<uint32_t, 512> t{};
+    for (uint32_t present = 0; present < 512; ++present)
+    {
+        uint32_t allowed = 0;
+        for (const auto& p : permutations)
+        {
+            uint32_t miniRows = (1u << p[0]) | (1u << (3 + p[1])) | (1u << (6 + p[2]));
+            if ((present & miniRows) == miniRows)
+            {
+                allowed |= miniRows;
+            }
+        }
+
+        for (int m = 0; m < 9; ++m)
+        {
+            if (allowed & (1u << m))
+            {
+                t[present] |= 0x7u << (9 * (m / 3) + 3 * (m % 3));
+            }
+        }
+    }
+    return t;
+}();
+
+inline uint32_t lockedCells(uint32_t band)
+{
+    uint32_t present = MiniRows[band & RowMask] | (MiniRows[(band >> 9) & RowMask] << 3) | (MiniRows[band >> 18] << 6);
+    return LockedCells[present];
+}
+
+/// columns with at least one cell of \a band
+inline uint32_t columns(uint32_t band)
+{
+    return (band | (band >> 9) | (band >> 18)) & RowMask;
+}
+
+/// columns with more than one cell of \a band
+inline uint32_t columnsTwice(uint32_t band)
+{
+    return ((band & (band >> 9)) | (band & (band >> 18)) | ((band >> 9) & (band >> 18))) & RowMask;
+}
+}
+
+Bitboard9::Bitboard9() : m_solution{}, m_nodes(0)
+{
+
+}
+
+bool Bitboard9::solve(int* grid)
+{
+    State s;
+    for (int d = 0; d < 9; ++d)
+    {
+        for (int b = 0; b < 3; ++b)
+        {
+            s.candidates[d][b] = BandMask;
+        }
+    }
+    for (int b = 0; b < 3; ++b)
+    {
+        s.unsolved[b] = BandMask;
+    }
+    s.changed = 0;
+    m_nodes = 0;
+
+    for (int cell = 0; cell < 81; ++cell)
+    {
+        int value = grid[cell];
+        if (value > 9 || (value > 0 && !place(s, cell / 27, cell % 27, value - 1)))
+        {
+            return false;
+        }
+    }
+
+    if (!search(s))
+    {
+        return false;
+    }
+
+    for (int cell = 0; cell < 81; ++cell)
+    {
+        uint32_t cellBit = 1u << (cell % 27);
+        for (int d = 0; d < 9; ++d)
+        {
+            if (m_solution.candidates[d][cell / 27] & cellBit)
+            {
+                grid[cell] = d + 1;
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+bool Bitboard9::place(State& s, int band, int bit, int digit)
+{
+    uint32_t cellBit = 1u << bit;
+    if (!(s.candidates[digit][band] & cellBit))
+    {
+        return false;
+    }
+
+    for (int d = 0; d < 9; ++d)
+    {
+        s.candidates[d][band] &= ~cellBit;
+    }
+
+    int row = bit / 9;
+    int col = bit % 9;
+    uint32_t peers = (RowMask << (9 * row)) | (BoxMask << (3 * (col / 3)));
+    s.candidates[digit][band] = (s.candidates[digit][band] & ~peers) | cellBit;
+    for (int b = 0; b < 3; ++b)
+    {
+        if (b != band)
+        {
+            s.candidates[digit][b] &= ~(ColMask << col);
+        }
+    }
+
+    s.unsolved[band] &= ~cellBit;
+    // every board of the band lost the cell, the boards of the digit lost the column
+    s.changed |= (BandBoards << band) | (DigitBoards << (3 * digit));
+    return true;
+}
+
+bool Bitboard9::propagate(State& s)
+{
+    // the boards only lose bits, so singles found on a board that changed meanwhile are still valid
+    for (;;)
+    {
+        // band locked candidates and hidden singles in rows and boxes of the changed boards
+        uint32_t touched = 0;
+        while (s.changed)
+        {
+            int board = std::countr_zero(s.changed);
+            s.changed &= s.changed - 1;
+            touched |= 1u << board;
+
+            int d = board / 3;
+            int b = board % 3;
+            uint32_t reduced = s.candidates[d][b] & lockedCells(s.candidates[d][b]);
+            if (reduced == 0)
+            {
+                return false;
+            }
+            s.candidates[d][b] = reduced;
+
+            uint32_t open = reduced & s.unsolved[b];
+            for (int k = 0; k < 3 && open; ++k)
+            {
+                uint32_t row = reduced & (RowMask << (9 * k));
+                uint32_t box = reduced & (BoxMask << (3 * k));
+                for (uint32_t unit : {row, box})
+                {
+                    if ((unit & open) && !(unit & (unit - 1)))
+                    {
+                        if (!place(s, b, std::countr_zero(unit), d))
+                            return false;
+                        open &= ~unit;
+                    }
+                }
+            }
+        }
+
+        // hidden singles in columns, the column is in one band only and there in one row
+        for (int d = 0; d < 9; ++d)
+        {
+            if (!(touched & (DigitBoards << (3 * d))))
+            {
+                continue;
+            }
+
+            const uint32_t* boards = s.candidates[d];
+            uint32_t c0 = columns(boards[0]), c1 = columns(boards[1]), c2 = columns(boards[2]);
+            if ((c0 | c1 | c2) != RowMask)
+            {
+                return false;
+            }
+
+            uint32_t single = (c0 ^ c1 ^ c2) & ~(c0 & c1 & c2)
+                            & ~columnsTwice(boards[0]) & ~columnsTwice(boards[1]) & ~columnsTwice(boards[2]);
+            for (int b = 0; b < 3 && single; ++b)
+            {
+                uint32_t cols = single & columns(boards[b]);
+                for (uint32_t cells = boards[b] & (cols | (cols << 9) | (cols << 18)) & s.unsolved[b]; cells; cells &= cells - 1)
+                {
+                    if (!place(s, b, std::countr_zero(cells), d))
+                        return false;
+                }
+            }
+        }
+
+        // naked singles, cells with exactly one digit left
+        for (int b = 0; b < 3; ++b)
+        {
+            if (!(touched & (BandBoards << b)))
+            {
+                continue;
+            }
+
+            uint32_t once = 0, twice = 0;
+            for (int d = 0; d < 9; ++d)
+            {
+                uint32_t open = s.candidates[d][b] & s.unsolved[b];
+                twice |= once & open;
+                once |= open;
+            }
+
+            if (s.unsolved[b] & ~once)
+            {
+                return false;
+            }
+
+            for (uint32_t cells = once & ~twice; cells; cells &= cells - 1)
+            {
+                int bit = std::countr_zero(cells);
+                int d = 0;
+                while (!(s.candidates[d][b] & (1u << bit)))
+                {
+                    if (++d == 9)
+                        return false;
+                }
+
+                if (!place(s, b, bit, d))
+                    return false;
+            }
+        }
+
+        if (!s.changed)
+        {
+            return true;
+        }
+    }
+}
+
+bool Bitboard9::search(State& s)
+{
+    if (!propagate(s))
+    {
+        return false;
+    }
+
+    if ((s.unsolved[0] | s.unsolved[1] | s.unsolved[2]) == 0)
+    {
+        m_solution = s;
+        return true;
+    }
+
+    // a cell with two candidates if there is one, otherwise the fewest candidates
+    int band = -1, bit = 0;
+    int fewest = 10;
+    for (int b = 0; b < 3 && fewest > 2; ++b)
+    {
+        uint32_t once = 0, twice = 0, thrice = 0;
+        for (int d = 0; d < 9; ++d)
+        {
+            uint32_t open = s.candidates[d][b] & s.unsolved[b];
+            thrice |= twice & open;
+            twice |= once & open;
+            once |= open;
+        }
+
+        if (uint32_t pairs = twice & ~thrice)
+        {
+            band = b;
+            bit = std::countr_zero(pairs);
+            fewest = 2;
+            break;
+        }
+
+        for (uint32_t cells = s.unsolved[b]; cells; cells &= cells - 1)
+        {
+            int cellBit = std::countr_zero(cells);
+            int count = 0;
+            for (int d = 0; d < 9; ++d)
+            {
+                count += (s.candidates[d][b] >> cellBit) & 1;
+            }
+
+            if (count < fewest)
+            {
+                fewest = count;
+                band = b;
+                bit = cellBit;
+            }
+        }
+    }
+
+    for (int d = 0; d < 9; ++d)
+    {
+        if (!(s.candidates[d][band] & (1u << bit)))
+        {
+            continue;
+        }
+
+        ++m_nodes;
+        State next = s;
+        if (place(next, band, bit, d) && search(next))
+        {
+            return true;
+        }
+    }
+    return false;
+}
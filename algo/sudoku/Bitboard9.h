@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Bitboard9 solver specialized for 9x9 sudokus on per digit bitboards
+ *
+ * Every digit has an 81 bit board of the cells it is still possible in, stored as three bands
+ * of 27 bits (3 rows of 9 cells). Solved cells stay set on the board of their digit.
+ * A digit appears once per row and box of a band, so the three mini rows (row x box) holding
+ * it form one of 6 permutations. The propagation keeps only the mini rows of the permutations
+ * that are still possible, one table lookup per digit and band that covers pointing pairs and
+ * box/line reduction inside the band. Naked and hidden singles are found with bit operations
+ * over the boards. The search branches on a cell with the fewest candidates and copies the
+ * 124 byte state per node instead of undoing its changes.
+ */
+class Bitboard9
+{
+public:
+    Bitboard9();
+
+    /**
+     * @brief solve fill all empty cells (value <= 0) of the row major 9x9 \a grid
+     * @return false if the given values contradict each other or no solution exists,
+     *         \a grid is unchanged in this case
+     */
+    bool solve(int* grid);
+
+    /**
+     * @return number of search nodes visited in the last call to solve()
+     */
+    size_t nodes() const { return m_nodes; }
+
+private:
+    struct State
+    {
+        // candidates[digit - 1][band], bit 9 * row + col within the band
+        uint32_t candidates[9][3];
+        // cells without a value per band
+        uint32_t unsolved[3];
+        // boards changed since their last band propagation, bit 3 * (digit - 1) + band
+        uint32_t changed;
+    };
+
+    /**
+     * @brief place set \a digit (0 based) in cell \a bit of \a band and remove it from the peers
+     * @return false if the digit is not possible there
+     */
+    static bool place(State& s, int band, int bit, int digit);
+
+    /**
+     * @brief propagate apply band locked candidates, naked and hidden singles until nothing changes
+     * @return false if \a s contradicts itself
+     */
+    static bool propagate(State& s);
+
+    bool search(State& s);
+
+private:
+    State m_solution;
+    size_t m_nodes;
+};
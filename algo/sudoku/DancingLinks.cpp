@@ -0,0 +1,233 @@
+#include "DancingLinks.h"
+
+#include <cassert>
+#include <cmath>
+
+DancingLinks::DancingLinks(size_t N) : m_N(N), m_nodes(0)
+{
+    size_t r = static_cast<size_t>(std::sqrt(double(N)));
+    assert(r * r == N);
+
+    const int numColumns = static_cast<int>(4 * N * N);
+    const int numRows = static_cast<int>(N * N * N);
+    const int numNodes = numColumns + 1 + 4 * numRows;
+
+    m_left.resize(numNodes);
+    m_right.resize(numNodes);
+    m_up.resize(numNodes);
+    m_down.resize(numNodes);
+    m_column.resize(numNodes);
+    m_rowId.resize(numNodes, -1);
+    m_size.assign(numColumns, 0);
+    m_rowStart.resize(numRows);
+
+    // header list
+    m_root = numColumns;
+    for (int c = 0; c <= numColumns; ++c)
+    {
+        m_left[c] = c == 0 ? numColumns : c - 1;
+        m_right[c] = c == numColumns ? 0 : c + 1;
+        m_up[c] = c;
+        m_down[c] = c;
+        m_column[c] = c;
+    }
+
+    int node = numColumns + 1;
+    for (size_t cell = 0; cell < N * N; ++cell)
+    {
+        size_t row = cell / N;
+        size_t col = cell % N;
+        size_t block = (row / r) * r + col / r;
+
+        for (size_t v = 0; v < N; ++v)
+        {
+            int id = static_cast<int>(cell * N + v);
+            int columns[4] = {
+                static_cast<int>(cell),
+                static_cast<int>(N * N + row * N + v),
+                static_cast<int>(2 * N * N + col * N + v),
+                static_cast<int>(3 * N * N + block * N + v)
+            };
+
+            m_rowStart[id] = node;
+            for (int k = 0; k < 4; ++k)
+            {
+                int n = node + k;
+                int c = columns[k];
+
+                m_left[n] = node + (k + 3) % 4;
+                m_right[n] = node + (k + 1) % 4;
+
+                // append at the bottom of column c
+                m_up[n] = m_up[c];
+                m_down[n] = c;
+                m_down[m_up[c]] = n;
+                m_up[c] = n;
+
+                m_column[n] = c;
+                m_rowId[n] = id;
+                ++m_size[c];
+            }
+            node += 4;
+        }
+    }
+}
+
+void DancingLinks::cover(int c)
+{
+    m_right[m_left[c]] = m_right[c];
+    m_left[m_right[c]] = m_left[c];
+    for (int i = m_down[c]; i != c; i = m_down[i])
+    {
+        for (int j = m_right[i]; j != i; j = m_right[j])
+        {
+            m_down[m_up[j]] = m_down[j];
+            m_up[m_down[j]] = m_up[j];
+            --m_size[m_column[j]];
+        }
+    }
+}
+
+void DancingLinks::uncover(int c)
+{
+    for (int i = m_up[c]; i != c; i = m_up[i])
+    {
+        for (int j = m_left[i]; j != i; j = m_left[j])
+        {
+            ++m_size[m_column[j]];
+            m_down[m_up[j]] = j;
+            m_up[m_down[j]] = j;
+        }
+    }
+    m_right[m_left[c]] = c;
+    m_left[m_right[c]] = c;
+}
+
+void DancingLinks::selectRow(int node)
+{
+    cover(m_column[node]);
+    for (int j = m_right[node]; j != node; j = m_right[j])
+    {
+        cover(m_column[j]);
+    }
+}
+
+void DancingLinks::deselectRow(int node)
+{
+    for (int j = m_left[node]; j != node; j = m_left[j])
+    {
+        uncover(m_column[j]);
+    }
+    uncover(m_column[node]);
+}
+
+bool DancingLinks::search()
+{
+    ++m_nodes;
+
+    if (m_right[m_root] == m_root)
+    {
+        return true;
+    }
+
+    // MRV: column with fewest remaining rows
+    int best = m_right[m_root];
+    for (int c = m_right[best]; c != m_root; c = m_right[c])
+    {
+        if (m_size[c] < m_size[best])
+        {
+            best = c;
+            if (m_size[c] <= 1)
+                break;
+        }
+    }
+
+    if (m_size[best] == 0)
+    {
+        return false;
+    }
+
+    bool found = false;
+    cover(best);
+    for (int r = m_down[best]; r != best && !found; r = m_down[r])
+    {
+        m_solution.push_back(m_rowId[r]);
+        for (int j = m_right[r]; j != r; j = m_right[j])
+        {
+            cover(m_column[j]);
+        }
+
+        found = search();
+
+        for (int j = m_left[r]; j != r; j = m_left[j])
+        {
+            uncover(m_column[j]);
+        }
+        if (!found)
+        {
+            m_solution.pop_back();
+        }
+    }
+    uncover(best);
+
+    return found;
+}
+
+bool DancingLinks::solve(int* grid)
+{
+    const size_t N = m_N;
+    m_nodes = 0;
+    m_solution.clear();
+
+    std::vector<int> selected;
+    bool consistent = true;
+    for (size_t cell = 0; cell < N * N && consistent; ++cell)
+    {
+        int value = grid[cell];
+        if (value <= 0)
+            continue;
+
+        if (value > static_cast<int>(N))
+        {
+            consistent = false;
+            break;
+        }
+
+        // all constraints of this row have to be still open, otherwise two givens collide
+        int node = m_rowStart[cell * N + value - 1];
+        int j = node;
+        do
+        {
+            int c = m_column[j];
+            if (m_right[m_left[c]] != c)
+            {
+                consistent = false;
+            }
+            j = m_right[j];
+        } while (j != node && consistent);
+
+        if (consistent)
+        {
+            selectRow(node);
+            selected.push_back(node);
+        }
+    }
+
+    bool solved = consistent && search();
+
+    if (solved)
+    {
+        for (int id : m_solution)
+        {
+            grid[id / N] = id % N + 1;
+        }
+    }
+
+    // restore the full matrix for the next grid
+    for (auto it = selected.rbegin(); it != selected.rend(); ++it)
+    {
+        deselectRow(*it);
+    }
+
+    return solved;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief DancingLinks exact cover solver (Knuth's Algorithm X) for NxN sudokus
+ *
+ * The constraint matrix (cell, row/value, column/value, block/value) is built
+ * once in the constructor. solve() selects the rows of the given values, searches
+ * and restores the matrix afterwards, so one instance can be reused for many grids.
+ * Columns are chosen by minimum remaining size (MRV).
+ */
+class DancingLinks
+{
+public:
+    DancingLinks(size_t N);
+
+    /**
+     * @brief solve fill all empty cells (value <= 0) of the row major \a grid
+     * @return false if the given values contradict each other or no solution exists,
+     *         \a grid is unchanged in this case
+     */
+    bool solve(int* grid);
+
+    /**
+     * @return number of search nodes visited in the last call to solve()
+     */
+    size_t nodes() const { return m_nodes; }
+
+private:
+    void cover(int c);
+    void uncover(int c);
+
+    bool search();
+
+    void selectRow(int node);
+    void deselectRow(int node);
+
+private:
+    size_t m_N;
+    int m_root;
+
+    // node links, headers are nodes 0..numColumns-1, root is node numColumns
+    std::vector<int> m_left, m_right, m_up, m_down;
+    std::vector<int> m_column;
+    std::vector<int> m_rowId;
+    std::vector<int> m_size;
+
+    // first node of each candidate row (cell * N + value - 1)
+    std::vector<int> m_rowStart;
+
+    std::vector<int> m_solution;
+    size_t m_nodes;
+};
@@ -0,0 +1,238 @@
+#include "PuzzleIO.h"
+
+#include <MappedFile.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+
+namespace
+{
+constexpr char Magic[4] = {'S', 'D', 'K', '4'};
+constexpr size_t HeaderSize = 8;
+// the writer hands blocks of about this size to the stream
+constexpr size_t BufferSize = size_t(1) << 20;
+
+/// cell value of a character of a line file, -1 if the character is no cell
+constexpr std::array<int8_t, 256> CharValues = []
+{
+    std::array<int8_t, 256> t{};
+    t.fill(-1);
+    t['.'] = 0;
+    for (int v = 0; v <= 9; ++v)
+        t['0' + v] = int8_t(v);
+    for (int v = 10; v < 36; ++v)
+    {
+        t['A' + v - 10] = int8_t(v);
+        t['a' + v - 10] = int8_t(v);
+    }
+    return t;
+}();
+
+/// largest value a line file can store
+constexpr size_t MaxLineValue = 35;
+/// largest value a packed file can store
+constexpr size_t MaxPackedValue = 15;
+
+/// character of each value in a line file
+constexpr char ValueChars[] = ".123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+inline char valueChar(int value)
+{
+    return value > 0 && value <= int(MaxLineValue) ? ValueChars[value] : '.';
+}
+
+inline size_t packedSize(size_t N)
+{
+    return (N * N + 1) / 2;
+}
+}
+
+PuzzleReader::PuzzleReader(const std::filesystem::path& path, size_t N) :
+    m_file(std::make_unique<MappedFile>(path)), m_N(N), m_format(PuzzleFormat::Lines), m_pos(0), m_line(0)
+{
+    const char* data = m_file->data();
+    if (m_file->size() >= HeaderSize && std::equal(Magic, Magic + 4, data))
+    {
+        m_N = static_cast<unsigned char>(data[4]);
+        if (m_N == 0 || m_N > MaxPackedValue || (m_file->size() - HeaderSize) % packedSize(m_N) != 0)
+        {
+            throw std::runtime_error(std::format("Invalid packed puzzle file {}", path.string()));
+        }
+
+        m_format = PuzzleFormat::Packed;
+        m_pos = HeaderSize;
+    }
+    else if (m_N > MaxLineValue)
+    {
+        throw std::runtime_error(std::format("{}x{} puzzles do not fit into the line format", m_N, m_N));
+    }
+}
+
+PuzzleReader::~PuzzleReader() = default;
+
+size_t PuzzleReader::read(int* outGrids, size_t count)
+{
+    const size_t numCells = m_N * m_N;
+
+    if (m_format == PuzzleFormat::Packed)
+    {
+        const size_t record = packedSize(m_N);
+        const auto* data = reinterpret_cast<const uint8_t*>(m_file->data());
+        size_t n = std::min(count, (m_file->size() - m_pos) / record);
+
+        int maxValue = 0;
+        for (size_t i = 0; i < n; ++i, m_pos += record)
+        {
+            const uint8_t* in = data + m_pos;
+            int* grid = outGrids + i * numCells;
+            for (size_t c = 0; c + 1 < numCells; c += 2)
+            {
+                grid[c] = in[c / 2] & 0xF;
+                grid[c + 1] = in[c / 2] >> 4;
+                maxValue = std::max({maxValue, grid[c], grid[c + 1]});
+            }
+            if (numCells % 2)
+            {
+                grid[numCells - 1] = in[numCells / 2] & 0xF;
+                maxValue = std::max(maxValue, grid[numCells - 1]);
+            }
+        }
+
+        if (maxValue > int(m_N))
+        {
+            throw std::runtime_error(std::format("Packed puzzle with a value above {}", m_N));
+        }
+        return n;
+    }
+
+    size_t n = 0;
+    while (n < count && readLine(outGrids + n * numCells))
+    {
+        ++n;
+    }
+    return n;
+}
+
+bool PuzzleReader::readLine(int* outGrid)
+{
+    const char* data = m_file->data();
+    const size_t size = m_file->size();
+    const size_t numCells = m_N * m_N;
+
+    while (m_pos < size)
+    {
+        const char* begin = data + m_pos;
+        const char* newline = static_cast<const char*>(std::memchr(begin, '\n', size - m_pos));
+        const char* end = newline ? newline : data + size;
+        m_pos = end - data + 1;
+        ++m_line;
+
+        if (end > begin && end[-1] == '\r')
+        {
+            --end;
+        }
+        if (end == begin || *begin == '#')
+        {
+            continue;
+        }
+
+        if (size_t(end - begin) != numCells)
+        {
+            throw std::runtime_error(std::format("Line {} has {} cells instead of {}", m_line, end - begin, numCells));
+        }
+
+        for (size_t c = 0; c < numCells; ++c)
+        {
+            int value = CharValues[static_cast<unsigned char>(begin[c])];
+            if (value < 0 || value > int(m_N))
+            {
+                throw std::runtime_error(std::format("Invalid cell '{}' in line {}", begin[c], m_line));
+            }
+            outGrid[c] = value;
+        }
+        return true;
+    }
+
+    return false;
+}
+
+PuzzleWriter::PuzzleWriter(const std::filesystem::path& path, size_t N, PuzzleFormat format) :
+    m_out(path, std::ios::binary), m_N(N), m_format(format)
+{
+    if (!m_out.is_open())
+    {
+        throw std::runtime_error(std::format("Cannot create file {}", path.string()));
+    }
+    if (N > (format == PuzzleFormat::Packed ? MaxPackedValue : MaxLineValue))
+    {
+        throw std::runtime_error(std::format("{}x{} puzzles do not fit into the file format", N, N));
+    }
+
+    m_buffer.reserve(BufferSize + N * N + 1);
+    if (format == PuzzleFormat::Packed)
+    {
+        m_buffer.insert(m_buffer.end(), Magic, Magic + 4);
+        m_buffer.insert(m_buffer.end(), {char(N), 0, 0, 0});
+    }
+}
+
+PuzzleWriter::~PuzzleWriter()
+{
+    // errors can only be reported by an explicit flush()
+    m_out.write(m_buffer.data(), m_buffer.size());
+}
+
+void PuzzleWriter::write(const int* grids, size_t count)
+{
+    const size_t numCells = m_N * m_N;
+    const size_t record = m_format == PuzzleFormat::Packed ? packedSize(m_N) : numCells + 1;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const int* grid = grids + i * numCells;
+
+        // the buffer never grows beyond its reserved size, so this does not reallocate
+        size_t pos = m_buffer.size();
+        m_buffer.resize(pos + record);
+        char* out = m_buffer.data() + pos;
+
+        if (m_format == PuzzleFormat::Packed)
+        {
+            // values <= 0 are empty cells (-1 from the OCR), they are stored as 0
+            for (size_t c = 0; c < numCells; c += 2)
+            {
+                int low = std::max(grid[c], 0);
+                int high = c + 1 < numCells ? std::max(grid[c + 1], 0) : 0;
+                out[c / 2] = char((low & 0xF) | ((high & 0xF) << 4));
+            }
+        }
+        else
+        {
+            for (size_t c = 0; c < numCells; ++c)
+            {
+                out[c] = valueChar(grid[c]);
+            }
+            out[numCells] = '\n';
+        }
+
+        if (m_buffer.size() >= BufferSize)
+        {
+            flush();
+        }
+    }
+}
+
+void PuzzleWriter::flush()
+{
+    m_out.write(m_buffer.data(), m_buffer.size());
+    m_out.flush();
+    m_buffer.clear();
+    if (!m_out)
+    {
+        throw std::runtime_error("Writing the puzzle file failed");
+    }
+}
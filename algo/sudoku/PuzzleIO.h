@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+class MappedFile;
+
+/**
+ * @brief PuzzleFormat file layouts of PuzzleReader and PuzzleWriter
+ *
+ * Lines: one puzzle per line, the N*N cells in row major order, '0' or '.' for an empty cell,
+ * values above 9 as 'A', 'B', ... (81 characters for 9x9). Empty lines and lines starting
+ * with '#' are skipped, "\r\n" line ends are accepted.
+ *
+ * Packed: the 8 byte header "SDK4", N and three zero bytes, then (N*N + 1) / 2 bytes per puzzle
+ * with 4 bits per cell, the even cells in the low nibble. Values must fit into 4 bits, so this
+ * is available for 4x4 and 9x9 only.
+ */
+enum class PuzzleFormat
+{
+    Lines,
+    Packed
+};
+
+/**
+ * @brief PuzzleReader sequential reader of a memory mapped puzzle file
+ *
+ * Puzzles are decoded straight from the mapping in chunks of the caller's size,
+ * so a file of millions of puzzles never has to fit into memory as integers.
+ */
+class PuzzleReader
+{
+public:
+    /**
+     * @brief PuzzleReader map \a path, packed files are recognized by their header
+     * @param N size of the puzzles of a line file, packed files store their size
+     * @throws std::runtime_error if the file cannot be mapped or its header is invalid
+     */
+    explicit PuzzleReader(const std::filesystem::path& path, size_t N = 9);
+    ~PuzzleReader();
+
+    size_t N() const { return m_N; }
+    PuzzleFormat format() const { return m_format; }
+
+    /**
+     * @brief read decode up to \a count following puzzles to \a outGrids, N*N values per puzzle, 0 for empty cells
+     * @return number of puzzles read, less than \a count at the end of the file
+     * @throws std::runtime_error for a line or packed puzzle that is not a puzzle of size N
+     */
+    size_t read(int* outGrids, size_t count);
+
+private:
+    bool readLine(int* outGrid);
+
+private:
+    std::unique_ptr<MappedFile> m_file;
+    size_t m_N;
+    PuzzleFormat m_format;
+    // read position in the mapping
+    size_t m_pos;
+    // line of the read position for error messages, only counted for line files
+    size_t m_line;
+};
+
+/**
+ * @brief PuzzleWriter buffered writer of puzzles or solutions in a PuzzleFormat
+ *
+ * Grids are encoded into a buffer that is written in large blocks, so results can
+ * be streamed out chunk by chunk while the solver works on the next one.
+ */
+class PuzzleWriter
+{
+public:
+    /**
+     * @throws std::runtime_error if \a path cannot be created or \a format cannot store values up to \a N
+     */
+    PuzzleWriter(const std::filesystem::path& path, size_t N, PuzzleFormat format);
+    ~PuzzleWriter();
+
+    /**
+     * @brief write append \a count grids of N*N values, grids filled with 0 (unsolved) are written as empty puzzles
+     */
+    void write(const int* grids, size_t count);
+
+    /**
+     * @brief flush write the buffered puzzles to the file
+     * @throws std::runtime_error if writing failed
+     */
+    void flush();
+
+private:
+    std::ofstream m_out;
+    size_t m_N;
+    PuzzleFormat m_format;
+    std::vector<char> m_buffer;
+};
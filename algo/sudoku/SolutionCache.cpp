@@ -0,0 +1,189 @@
+#include "SolutionCache.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numeric>
+
+SolutionCache::SolutionCache(size_t N, size_t capacity, bool symmetry)
+    : m_N(N), m_capacity(capacity), m_symmetry(symmetry), m_hits(0), m_misses(0)
+{
+    m_rootN = static_cast<size_t>(std::sqrt(double(N)));
+    assert(m_rootN * m_rootN == N);
+}
+
+bool SolutionCache::find(const int* grid, int* outSolution)
+{
+    std::string key;
+    Transform transform;
+    auto it = m_index.end();
+    if (m_capacity > 0 && signature(grid, key, transform))
+    {
+        it = m_index.find(key);
+    }
+
+    if (it == m_index.end())
+    {
+        ++m_misses;
+        return false;
+    }
+
+    ++m_hits;
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+
+    std::vector<int> inputDigit(m_N + 1, 0);
+    for (size_t d = 1; d <= m_N; ++d)
+    {
+        inputDigit[transform.digits[d]] = int(d);
+    }
+
+    const std::vector<uint8_t>& solution = it->second->solution;
+    for (size_t k = 0; k < m_N * m_N; ++k)
+    {
+        outSolution[transform.source[k]] = inputDigit[solution[k]];
+    }
+    return true;
+}
+
+void SolutionCache::insert(const int* grid, const int* solution)
+{
+    std::string key;
+    Transform transform;
+    if (m_capacity == 0 || !signature(grid, key, transform) || m_index.count(key))
+    {
+        return;
+    }
+
+    if (m_entries.size() >= m_capacity)
+    {
+        m_index.erase(m_entries.back().key);
+        m_entries.pop_back();
+    }
+
+    Entry entry{key, std::vector<uint8_t>(m_N * m_N)};
+    for (size_t k = 0; k < m_N * m_N; ++k)
+    {
+        entry.solution[k] = transform.digits[solution[transform.source[k]]];
+    }
+
+    m_entries.push_front(std::move(entry));
+    m_index.emplace(std::move(key), m_entries.begin());
+}
+
+void SolutionCache::clear()
+{
+    m_entries.clear();
+    m_index.clear();
+    m_hits = 0;
+    m_misses = 0;
+}
+
+bool SolutionCache::signature(const int* grid, std::string& outKey, Transform& outTransform) const
+{
+    const size_t numCells = m_N * m_N;
+    for (size_t i = 0; i < numCells; ++i)
+    {
+        if (grid[i] > int(m_N))
+        {
+            return false;
+        }
+    }
+
+    outTransform.source.resize(numCells);
+    std::iota(outTransform.source.begin(), outTransform.source.end(), 0);
+    if (!m_symmetry)
+    {
+        outTransform.digits.resize(m_N + 1);
+        std::iota(outTransform.digits.begin(), outTransform.digits.end(), 0);
+        // values <= 0 are empty cells (-1 from the OCR), they all map to 0
+        outKey.resize(numCells);
+        for (size_t i = 0; i < numCells; ++i)
+        {
+            outKey[i] = char(std::max(grid[i], 0));
+        }
+        return true;
+    }
+
+    relabel(grid, outTransform.source, outKey, outTransform.digits);
+
+    // every band and stack order is tried, that is (rootN!)^2 * 2 signatures
+    const size_t maxPermuted = 4;
+    std::vector<size_t> bands(m_rootN), stacks(m_rootN);
+    std::vector<uint16_t> source(numCells);
+    std::vector<uint8_t> digits;
+    std::string key;
+    for (bool transpose : {false, true})
+    {
+        std::iota(bands.begin(), bands.end(), 0);
+        do
+        {
+            std::iota(stacks.begin(), stacks.end(), 0);
+            do
+            {
+                for (size_t row = 0; row < m_N; ++row)
+                {
+                    size_t srcRow = bands[row / m_rootN] * m_rootN + row % m_rootN;
+                    for (size_t col = 0; col < m_N; ++col)
+                    {
+                        size_t srcCol = stacks[col / m_rootN] * m_rootN + col % m_rootN;
+                        source[row * m_N + col] = uint16_t(transpose ? srcCol * m_N + srcRow : srcRow * m_N + srcCol);
+                    }
+                }
+
+                if (relabel(grid, source, key, digits, &outKey))
+                {
+                    std::swap(outKey, key);
+                    std::swap(outTransform.source, source);
+                    std::swap(outTransform.digits, digits);
+                }
+            } while (m_rootN <= maxPermuted && std::next_permutation(stacks.begin(), stacks.end()));
+        } while (m_rootN <= maxPermuted && std::next_permutation(bands.begin(), bands.end()));
+    }
+
+    return true;
+}
+
+bool SolutionCache::relabel(const int* grid, const std::vector<uint16_t>& source, std::string& outKey, std::vector<uint8_t>& outDigits,
+                            const std::string* bound) const
+{
+    const size_t numCells = m_N * m_N;
+    outKey.resize(numCells);
+    outDigits.assign(m_N + 1, 0);
+
+    // only decided while the prefix equals the bound
+    bool equal = bound != nullptr;
+    uint8_t next = 1;
+    for (size_t k = 0; k < numCells; ++k)
+    {
+        int value = std::max(grid[source[k]], 0);
+        if (value > 0 && outDigits[value] == 0)
+        {
+            outDigits[value] = next++;
+        }
+        outKey[k] = char(outDigits[value]);
+
+        if (equal && outKey[k] != (*bound)[k])
+        {
+            if (outKey[k] > (*bound)[k])
+            {
+                return false;
+            }
+            equal = false;
+        }
+    }
+
+    if (equal)
+    {
+        return false;
+    }
+
+    // digits without givens take the remaining labels, any order is a valid relabeling of the solution
+    for (size_t d = 1; d <= m_N; ++d)
+    {
+        if (outDigits[d] == 0)
+        {
+            outDigits[d] = next++;
+        }
+    }
+    return true;
+}
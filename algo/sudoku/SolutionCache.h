@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief SolutionCache LRU cache of solved NxN sudokus keyed by a canonical signature of the givens
+ *
+ * The signature is the row major list of givens. With \a symmetry the grid is also normalized
+ * under transposition and permutations of the bands and stacks (up to 16x16), the digits are
+ * relabeled in order of their first appearance, and the smallest of these signatures is used.
+ * Equivalent puzzles then share one entry, the stored solution is mapped back through the
+ * transformation of the query.
+ */
+class SolutionCache
+{
+public:
+    SolutionCache(size_t N, size_t capacity, bool symmetry);
+
+    /**
+     * @brief find look up the solution of \a grid (N*N values, 0 or -1 for empty cells)
+     * @return false on a miss, \a outSolution is only written on a hit
+     */
+    bool find(const int* grid, int* outSolution);
+
+    /**
+     * @brief insert store \a solution of \a grid, the least recently used entry is dropped if the cache is full
+     */
+    void insert(const int* grid, const int* solution);
+
+    void clear();
+
+    size_t size() const { return m_entries.size(); }
+    size_t capacity() const { return m_capacity; }
+    bool symmetry() const { return m_symmetry; }
+
+    size_t hits() const { return m_hits; }
+    size_t misses() const { return m_misses; }
+
+private:
+    /// input cell of every canonical cell and canonical label of every input digit
+    struct Transform
+    {
+        std::vector<uint16_t> source;
+        std::vector<uint8_t> digits;
+    };
+
+    /**
+     * @brief signature canonical key of \a grid and the transformation that produces it
+     * @return false if \a grid has values above N, those are not cached. Values <= 0 are empty cells.
+     */
+    bool signature(const int* grid, std::string& outKey, Transform& outTransform) const;
+
+    /**
+     * @brief relabel key of the givens read in the order of \a source with digits numbered by first appearance
+     * @return false if the key is not smaller than \a bound, it stops at the first larger value then
+     */
+    bool relabel(const int* grid, const std::vector<uint16_t>& source, std::string& outKey, std::vector<uint8_t>& outDigits,
+                 const std::string* bound = nullptr) const;
+
+private:
+    struct Entry
+    {
+        std::string key;
+        std::vector<uint8_t> solution;
+    };
+
+    size_t m_N;
+    size_t m_rootN;
+    size_t m_capacity;
+    bool m_symmetry;
+
+    // most recently used first
+    std::list<Entry> m_entries;
+    std::unordered_map<std::string, std::list<Entry>::iterator> m_index;
+
+    size_t m_hits;
+    size_t m_misses;
+};
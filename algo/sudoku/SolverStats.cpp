@@ -0,0 +1,133 @@
+#include "SolverStats.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <format>
+
+const char* ruleName(Rule rule)
+{
+    switch (rule)
+    {
+    case Rule::NakedSingle: return "naked singles";
+    case Rule::HiddenSingle: return "hidden singles";
+    case Rule::VectorSingle: return "vectorized singles";
+    case Rule::NakedPairs: return "naked pairs";
+    case Rule::HiddenPairs: return "hidden pairs";
+    case Rule::PointingPairs: return "pointing pairs";
+    case Rule::BoxLineReduction: return "box line reduction";
+    case Rule::XWing: return "x-wing";
+    default: return "unknown";
+    }
+}
+
+size_t LatencyHistogram::bucket(uint64_t ns)
+{
+    if (ns < SubBuckets)
+    {
+        return ns;
+    }
+
+    // the SubBits bits below the highest set bit select the bucket within its power of two
+    size_t exponent = std::bit_width(ns) - 1;
+    size_t sub = (ns >> (exponent - SubBits)) & (SubBuckets - 1);
+    return (exponent - SubBits + 1) * SubBuckets + sub;
+}
+
+uint64_t LatencyHistogram::bucketMax(size_t bucket)
+{
+    if (bucket < SubBuckets)
+    {
+        return bucket;
+    }
+
+    size_t exponent = bucket / SubBuckets + SubBits - 1;
+    uint64_t width = uint64_t(1) << (exponent - SubBits);
+    uint64_t lowest = (SubBuckets + bucket % SubBuckets) * width;
+    return lowest + width - 1;
+}
+
+void LatencyHistogram::record(double ms)
+{
+    uint64_t ns = static_cast<uint64_t>(std::llround(std::max(0.0, ms) * 1e6));
+    ++m_counts[bucket(ns)];
+    ++m_count;
+    m_max = std::max(m_max, ns);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other)
+{
+    for (size_t b = 0; b < NumBuckets; ++b)
+    {
+        m_counts[b] += other.m_counts[b];
+    }
+    m_count += other.m_count;
+    m_max = std::max(m_max, other.m_max);
+}
+
+double LatencyHistogram::percentile(double percent) const
+{
+    if (m_count == 0)
+    {
+        return 0.0;
+    }
+
+    size_t rank = std::max<size_t>(1, static_cast<size_t>(std::ceil(percent / 100.0 * double(m_count))));
+    size_t seen = 0;
+    for (size_t b = 0; b < NumBuckets; ++b)
+    {
+        seen += m_counts[b];
+        if (seen >= rank)
+        {
+            return double(std::min(bucketMax(b), m_max)) / 1e6;
+        }
+    }
+    return max();
+}
+
+double LatencyHistogram::max() const
+{
+    return double(m_max) / 1e6;
+}
+
+void SolverStats::merge(const SolverStats& other)
+{
+    searchNodes += other.searchNodes;
+    backtracks += other.backtracks;
+    restarts += other.restarts;
+    propagationPasses += other.propagationPasses;
+    maxDepth = std::max(maxDepth, other.maxDepth);
+    budgetExceeded += other.budgetExceeded;
+    for (size_t r = 0; r < ruleChanges.size(); ++r)
+    {
+        ruleChanges[r] += other.ruleChanges[r];
+    }
+    latency.merge(other.latency);
+}
+
+std::string SolverStats::summary() const
+{
+    std::string s = std::format("{} search nodes, {} backtracks, {} propagation passes, max depth {}",
+                                searchNodes, backtracks, propagationPasses, maxDepth);
+    if (restarts > 0)
+    {
+        s += std::format(", {} restarts", restarts);
+    }
+    if (budgetExceeded > 0)
+    {
+        s += std::format(", {} over budget", budgetExceeded);
+    }
+    for (size_t r = 0; r < ruleChanges.size(); ++r)
+    {
+        if (ruleChanges[r] > 0)
+        {
+            s += std::format(", {} {}", ruleChanges[r], ruleName(Rule(r)));
+        }
+    }
+    if (latency.count() > 0)
+    {
+        s += std::format(", latency p50 {:.4f} ms p99 {:.4f} ms max {:.4f} ms over {} puzzles",
+                         latency.percentile(50.0), latency.percentile(99.0), latency.max(), latency.count());
+    }
+    return s;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Rule deductions of the CPU propagation, counted by Field::solveStep() and Sudoku::propagate()
+ */
+enum class Rule : size_t
+{
+    NakedSingle,
+    HiddenSingle,
+    VectorSingle,   // naked or hidden single found by SudokuSimd
+    NakedPairs,
+    HiddenPairs,
+    PointingPairs,
+    BoxLineReduction,
+    XWing,
+    Count
+};
+
+/// solved cells per single rule, removed candidates (changed cells) per higher order rule
+using RuleCounts = std::array<size_t, size_t(Rule::Count)>;
+
+const char* ruleName(Rule rule);
+
+/**
+ * @brief LatencyHistogram log linear latency histogram in the style of HdrHistogram
+ *
+ * Values are stored in nanoseconds, every power of two is split into SubBuckets buckets,
+ * so percentiles are exact to 1 / SubBuckets of the value. Recording is constant time
+ * and histograms of several threads are merged by adding the buckets.
+ */
+class LatencyHistogram
+{
+public:
+    /**
+     * @brief record add one latency of \a ms milliseconds
+     */
+    void record(double ms);
+    void merge(const LatencyHistogram& other);
+
+    size_t count() const { return m_count; }
+
+    /**
+     * @return latency in ms that \a percent percent of the recorded values do not exceed, 0 if empty
+     */
+    double percentile(double percent) const;
+    double max() const;
+
+private:
+    static constexpr size_t SubBits = 4;
+    static constexpr size_t SubBuckets = size_t(1) << SubBits;
+    static constexpr size_t NumBuckets = (64 - SubBits + 1) * SubBuckets;
+
+    static size_t bucket(uint64_t ns);
+    /// largest value that falls into \a bucket
+    static uint64_t bucketMax(size_t bucket);
+
+private:
+    std::array<uint32_t, NumBuckets> m_counts{};
+    size_t m_count = 0;
+    uint64_t m_max = 0;
+};
+
+/**
+ * @brief SolverStats counters of one or more sudoku searches
+ *
+ * Every worker thread fills its own instance, Sudoku merges them after each run.
+ * The search counters are filled by the CPU searches and the host driven GPU search,
+ * the device search only reports its search nodes.
+ */
+struct alignas(64) SolverStats
+{
+    /// trial values set
+    size_t searchNodes = 0;
+    /// trial values that led to a contradiction
+    size_t backtracks = 0;
+    /// searches started over with other tie-breaks after their node limit, see the "restarts" setting
+    size_t restarts = 0;
+    /// propagation steps until the fixpoint, vectorized propagations count as one
+    size_t propagationPasses = 0;
+    /// deepest recursion level that was propagated
+    size_t maxDepth = 0;
+    /// grids given up because the time or node budget ran out or the solve was cancelled
+    size_t budgetExceeded = 0;
+    RuleCounts ruleChanges{};
+    /// time to solve each puzzle
+    LatencyHistogram latency;
+
+    void merge(const SolverStats& other);
+
+    /**
+     * @return one line with all counters and p50/p99/max latency
+     */
+    std::string summary() const;
+};
@@ -1,3 +1,20 @@
+/**
+ * Grid size N, bytes per cell of the possibilities array and block size of a kernel.
+ * Programs built with -DSUDOKU_N=<N> -DSUDOKU_ROOT_N=<root of N> get them as constants, the runtime arguments
+ * are ignored then. All helpers are inlined into the kernels, so their loops over N get constant trip counts
+ * and can be unrolled completely.
+ */
+#ifdef SUDOKU_N
+    #define SUDOKU_DIMENSIONS(argN, argCellSize) \
+        const uint N = SUDOKU_N; \
+        const uint cellSize = (SUDOKU_N + 7) / 8; \
+        const uint rootN = SUDOKU_ROOT_N;
+#else
+    #define SUDOKU_DIMENSIONS(argN, argCellSize) \
+        const uint N = argN; \
+        const uint cellSize = argCellSize; \
+        const uint rootN = sqrt((float)N);
+#endif
 
 bool possible(uint row, uint col, __local uchar* possibilities, const int value, const uint N, const uint cellSize)
 {
@@ -40,8 +57,8 @@ void disable(uint row, uint col, __local uchar* possibilities, const int value,
 
 bool solved(__local int* field, __local int* flags, const uint N)
 {
-    int col = get_global_id(0); // assume N
-    int row = get_global_id(1); // assume N
+    int col = get_local_id(0); // assume N
+    int row = get_local_id(1); // assume N
 
     if (row == 0 && col == 0)
     {
@@ -65,8 +82,8 @@ bool solved(__local int* field, __local int* flags, const uint N)
 
 bool valid(__local int* field, __local int* flags, const uint N)
 {
-    int col = get_global_id(0); // assume N
-    int row = get_global_id(1); // assume N
+    int col = get_local_id(0); // assume N
+    int row = get_local_id(1); // assume N
 
     if (row == 0 && col == 0)
     {
@@ -90,8 +107,8 @@ bool valid(__local int* field, __local int* flags, const uint N)
 
 void updatePossibilities(__local int* field, __local uchar* possibilities, const uint N, const uint cellSize, const uint rootN)
 {
-    int col = get_global_id(0); // assume N
-    int row = get_global_id(1); // assume N
+    int col = get_local_id(0); // assume N
+    int row = get_local_id(1); // assume N
 
     // Disable Horizontal Sweep
     for (int c = 0; c < N; ++c)
@@ -148,29 +165,15 @@ void updatePossibilities(__local int* field, __local uchar* possibilities, const
     }
 }
 
-__kernel void Sudoku(__global int* array, __global uchar* outDebugArray, __global int* outFlags, __local int* flags, __local int* field, __local uchar* possibilities, const uint N, const uint cellSize)
+void initPossibilities(__local uchar* possibilities, const uint N, const uint cellSize)
 {
-    // solved, valid, changesThisStep, overallChanges
-    //__local int flags[4];
-
-    uint rootN = sqrt((float)N);
-
-    int col = get_global_id(0); // assume N
-    int row = get_global_id(1); // assume N
+    int col = get_local_id(0); // assume N
+    int row = get_local_id(1); // assume N
 
     int groupSize = get_local_size(0) * get_local_size(1);
 
     uint posSize = N * N * cellSize;
 
-    // init flags
-    if (row == 0 && col < 4)
-    {
-        flags[col] = 0;
-    }
-
-    barrier(CLK_LOCAL_MEM_FENCE);
-
-    // Init possibilities array
     int index = row * N + col;
     int passes = posSize / groupSize;
     if (posSize % groupSize > 0)
@@ -187,14 +190,21 @@ __kernel void Sudoku(__global int* array, __global uchar* outDebugArray, __globa
     }
 
     barrier(CLK_LOCAL_MEM_FENCE);
+}
 
-    // Load Field from global mem
-    if (row < N && col < N)
+/**
+ * Set naked singles in \a field until nothing changes, \a possibilities must be freshly initialized.
+ * Leaves unsolved cells in flags[0], invalid cells in flags[1] and the number of set values in flags[3]
+ */
+void propagateSingles(__local int* field, __local int* flags, __local uchar* possibilities, const uint N, const uint cellSize, const uint rootN)
+{
+    int col = get_local_id(0); // assume N
+    int row = get_local_id(1); // assume N
+
+    // init flags
+    if (row == 0 && col < 4)
     {
-        int value = array[row * N + col];
-        if (value == -1)
-            value = 0;
-        field[row * N + col] = value;
+        flags[col] = 0;
     }
 
     // Solve loop
@@ -292,6 +302,33 @@ __kernel void Sudoku(__global int* array, __global uchar* outDebugArray, __globa
     }
 
     barrier(CLK_LOCAL_MEM_FENCE);
+}
+
+/**
+ * Solve all singles of the grid in \a array with one NxN work-group,
+ * writes the grid back and the flags (unsolved cells, invalid cells, changes) to \a outFlags
+ */
+void solveSingles(__global int* array, __global int* outFlags, __local int* flags, __local int* field, __local uchar* possibilities, const uint N, const uint cellSize, const uint rootN)
+{
+    // solved, valid, changesThisStep, overallChanges
+    //__local int flags[4];
+
+    int col = get_local_id(0); // assume N
+    int row = get_local_id(1); // assume N
+
+    // Init possibilities array
+    initPossibilities(possibilities, N, cellSize);
+
+    // Load Field from global mem
+    if (row < N && col < N)
+    {
+        int value = array[row * N + col];
+        if (value == -1)
+            value = 0;
+        field[row * N + col] = value;
+    }
+
+    propagateSingles(field, flags, possibilities, N, cellSize, rootN);
 
     // Write Field
     array[row * N + col] = field[row * N + col];
@@ -307,6 +344,25 @@ __kernel void Sudoku(__global int* array, __global uchar* outDebugArray, __globa
         outFlags[2] = flags[3]; // overall changes
     }
     barrier(CLK_LOCAL_MEM_FENCE);
+}
+
+__kernel void Sudoku(__global int* array, __global uchar* outDebugArray, __global int* outFlags, __local int* flags, __local int* field, __local uchar* possibilities, const uint argN, const uint argCellSize)
+{
+    SUDOKU_DIMENSIONS(argN, argCellSize)
+
+    solveSingles(array, outFlags, flags, field, possibilities, N, cellSize, rootN);
+
+    int col = get_local_id(0);
+    int row = get_local_id(1);
+
+    int groupSize = get_local_size(0) * get_local_size(1);
+
+    uint posSize = N * N * cellSize;
+
+    int index = row * N + col;
+    int passes = posSize / groupSize;
+    if (posSize % groupSize > 0)
+        passes++;
 
     // Write Debug (possibilities array)
     for (int i = 0; i < passes; ++i)
@@ -319,3 +375,459 @@ __kernel void Sudoku(__global int* array, __global uchar* outDebugArray, __globa
         }
     }
 }
+
+/**
+ * Same as Sudoku for many grids in one launch, one NxN work-group per grid.
+ * Grid g = get_group_id(0) is stored at \a arrays + g * N * N, its flags at \a outFlags + 3 * g
+ */
+__kernel void SudokuBatch(__global int* arrays, __global int* outFlags, __local int* flags, __local int* field, __local uchar* possibilities, const uint argN, const uint argCellSize)
+{
+    SUDOKU_DIMENSIONS(argN, argCellSize)
+
+    uint grid = get_group_id(0);
+
+    solveSingles(arrays + grid * N * N, outFlags + grid * 3, flags, field, possibilities, N, cellSize, rootN);
+}
+
+
+#define SEARCH_RUNNING 0
+#define SEARCH_SOLVED 1
+#define SEARCH_EXHAUSTED 2
+
+/**
+ * Try the next value of the deepest level of \a stack that has one left, one more level is on the stack if \a opened.
+ * Only called by one work-item, see SudokuSearch for the layout
+ */
+void nextBranch(__global int* stack, __local int* search, const uint numCells, const bool opened)
+{
+    uint entrySize = numCells + 3;
+
+    int depth = search[0] + (opened ? 1 : 0);
+    while (depth > 0)
+    {
+        __global int* top = stack + (depth - 1) * entrySize;
+        uint rest = top[numCells + 1] & ~((0x1 << top[numCells + 2]) - 1);
+        if (rest != 0)
+        {
+            top[numCells + 2] = 32 - clz(rest & (~rest + 1));
+            search[2]++;
+            break;
+        }
+        depth--;
+    }
+
+    search[0] = depth;
+    if (depth == 0)
+    {
+        search[1] = SEARCH_EXHAUSTED;
+    }
+}
+
+/**
+ * Depth first search for the grid at \a arrays + g * N * N with g = get_group_id(0), one NxN work-group per grid.
+ *
+ * Every level of the search lives in \a stacks + g * N * N * (N * N + 3): the grid after propagation followed by
+ * the branch cell, its candidate mask and the value tried last. Every level fills at least one more cell than
+ * the one below, so N * N levels are always enough.
+ * \a search holds the depth, the state and the number of tried values.
+ * The solution is written back to \a arrays, the flags (unsolved cells, 1 if there is no solution, tried values)
+ * to \a outFlags + 3 * g.
+ */
+__kernel void SudokuSearch(__global int* arrays, __global int* outFlags, __local int* flags, __local int* field, __local uchar* possibilities, const uint argN, const uint argCellSize, __global int* stacks, __local int* search)
+{
+    SUDOKU_DIMENSIONS(argN, argCellSize)
+
+    uint grid = get_group_id(0);
+    uint numCells = N * N;
+    uint entrySize = numCells + 3;
+
+    __global int* array = arrays + grid * numCells;
+    __global int* stack = stacks + (size_t)grid * numCells * entrySize;
+
+    int col = get_local_id(0); // assume N
+    int row = get_local_id(1); // assume N
+    int index = row * N + col;
+
+    if (index == 0)
+    {
+        search[0] = 0;
+        search[1] = SEARCH_RUNNING;
+        search[2] = 0;
+    }
+
+    // Load Field from global mem
+    int value = array[index];
+    field[index] = value == -1 ? 0 : value;
+
+    while (true)
+    {
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        initPossibilities(possibilities, N, cellSize);
+        propagateSingles(field, flags, possibilities, N, cellSize, rootN);
+
+        bool opened = false;
+        if (flags[0] == 0 && flags[1] == 0)
+        {
+            // singles set in the same step may collide, check the full grid once more
+            initPossibilities(possibilities, N, cellSize);
+            updatePossibilities(field, possibilities, N, cellSize, rootN);
+
+            if (!possible(row, col, possibilities, field[index], N, cellSize))
+            {
+                atomic_inc(&flags[1]);
+            }
+
+            barrier(CLK_LOCAL_MEM_FENCE);
+
+            if (flags[1] == 0)
+            {
+                if (index == 0)
+                {
+                    search[1] = SEARCH_SOLVED;
+                }
+                break;
+            }
+        }
+        else if (flags[1] == 0)
+        {
+            // open a new level on the cell with fewest candidates,
+            // possibilities still match the field since the last propagation step changed nothing
+            __global int* top = stack + search[0] * entrySize;
+            top[index] = field[index];
+
+            if (index == 0)
+            {
+                uint bestCell = 0;
+                uint bestMask = 0;
+                uint bestCount = N + 1;
+                for (uint cell = 0; cell < numCells && bestCount > 2; ++cell)
+                {
+                    if (field[cell] > 0)
+                        continue;
+
+                    uint mask = 0;
+                    for (uint v = 1; v <= N; ++v)
+                    {
+                        if (possible(cell / N, cell % N, possibilities, v, N, cellSize))
+                            mask |= 0x1 << (v - 1);
+                    }
+
+                    uint count = popcount(mask);
+                    if (count < bestCount)
+                    {
+                        bestCell = cell;
+                        bestMask = mask;
+                        bestCount = count;
+                    }
+                }
+
+                top[numCells] = bestCell;
+                top[numCells + 1] = bestMask;
+                top[numCells + 2] = 0;
+                opened = true;
+            }
+        }
+
+        barrier(CLK_LOCAL_MEM_FENCE | CLK_GLOBAL_MEM_FENCE);
+
+        if (index == 0)
+        {
+            nextBranch(stack, search, numCells, opened);
+        }
+
+        barrier(CLK_LOCAL_MEM_FENCE | CLK_GLOBAL_MEM_FENCE);
+
+        if (search[1] == SEARCH_EXHAUSTED)
+        {
+            break;
+        }
+
+        __global int* top = stack + (search[0] - 1) * entrySize;
+        field[index] = index == top[numCells] ? top[numCells + 2] : top[index];
+    }
+
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    // Write Field
+    array[index] = field[index];
+
+    // Write flags
+    if (index == 0)
+    {
+        bool found = search[1] == SEARCH_SOLVED;
+        outFlags[grid * 3] = found ? 0 : flags[0];
+        outFlags[grid * 3 + 1] = found ? 0 : 1;
+        outFlags[grid * 3 + 2] = search[2];
+    }
+}
+
+// marks a cell that got its value in the last round of propagateMasks, above the bits of the values
+#define SET_IN_ROUND 0x80000000
+
+/**
+ * Cell \a i of unit \a unit, units are rows (type 0), columns (type 1) and blocks (type 2)
+ */
+uint unitCell(const uint type, const uint unit, const uint i, const uint N, const uint rootN)
+{
+    if (type == 0)
+        return unit * N + i;
+    if (type == 1)
+        return i * N + unit;
+
+    uint row = (unit / rootN) * rootN + i / rootN;
+    uint col = (unit % rootN) * rootN + i % rootN;
+    return row * N + col;
+}
+
+/**
+ * Set naked singles in \a field like propagateSingles, with the candidates of every cell as one uint in \a candidates
+ * (bit value - 1). A round costs two barriers: one work-item per unit ORs the solved values of its unit into
+ * \a units, then every cell removes the values of its three units at once. The cell states are counted by the row
+ * work-items and summed by every work-item on its own, so no atomics are needed and the result is uniform.
+ * \a units needs 9 * N ints. Afterwards \a candidates match \a field unless the grid is invalid.
+ * @param setValues number of values set
+ * @return unsolved cells, -1 if a cell has no candidate left or a value is twice in a unit
+ */
+int propagateMasks(__local int* field, __local uint* candidates, __local int* units, const uint N, const uint rootN, int* setValues)
+{
+    int col = get_local_id(0); // assume N
+    int row = get_local_id(1); // assume N
+    int index = row * N + col;
+
+    uint all = (0x1 << N) - 1;
+    uint block = (row / rootN) * rootN + col / rootN;
+
+    // solved values and values solved twice of rows, columns and blocks, then unsolved, invalid and set cells per row
+    __local int* solvedIn = units;
+    __local int* twiceIn = units + 3 * N;
+    __local int* rowStates = units + 6 * N;
+
+    candidates[index] = 0;
+    *setValues = 0;
+
+    bool first = true;
+    while (true)
+    {
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        if (row < 3)
+        {
+            uint once = 0;
+            uint twice = 0;
+            int unsolved = 0;
+            int invalid = 0;
+            int set = 0;
+            for (uint i = 0; i < N; ++i)
+            {
+                uint cell = unitCell(row, col, i, N, rootN);
+                int value = field[cell];
+                if (value > 0)
+                {
+                    uint bit = 0x1 << (value - 1);
+                    twice |= once & bit;
+                    once |= bit;
+                }
+                else
+                {
+                    unsolved++;
+                    if (value < 0)
+                        invalid++;
+                }
+
+                if (candidates[cell] & SET_IN_ROUND)
+                    set++;
+            }
+
+            solvedIn[row * N + col] = once;
+            twiceIn[row * N + col] = twice;
+            if (row == 0)
+            {
+                rowStates[3 * col] = unsolved;
+                rowStates[3 * col + 1] = invalid;
+                rowStates[3 * col + 2] = set;
+            }
+        }
+
+        barrier(CLK_LOCAL_MEM_FENCE);
+
+        int unsolved = 0;
+        int invalid = 0;
+        int set = 0;
+        for (uint u = 0; u < N; ++u)
+        {
+            unsolved += rowStates[3 * u];
+            invalid += rowStates[3 * u + 1];
+            set += rowStates[3 * u + 2];
+        }
+        for (uint u = 0; u < 3 * N; ++u)
+        {
+            if (twiceIn[u] != 0)
+                invalid++;
+        }
+        *setValues += set;
+
+        if (invalid > 0)
+            return -1;
+
+        if (unsolved == 0 || (set == 0 && !first))
+            return unsolved;
+
+        // Single solve step
+        int value = field[index];
+        uint mask = value > 0 ? 0x1 << (value - 1) : 0;
+        if (value == 0)
+        {
+            mask = all & ~(solvedIn[row] | solvedIn[N + col] | solvedIn[2 * N + block]);
+            if (mask == 0)
+            {
+                // no possible solutions left
+                field[index] = -1;
+            }
+            else if ((mask & (mask - 1)) == 0)
+            {
+                // only value possible
+                field[index] = 32 - clz(mask);
+                mask |= SET_IN_ROUND;
+            }
+        }
+        candidates[index] = mask;
+
+        first = false;
+    }
+}
+
+/**
+ * Same as SudokuBatch with propagateMasks, \a units needs 9 * N ints and \a candidates N * N uints.
+ * \a argCellSize is not used, it keeps the argument list of SudokuBatch
+ */
+__kernel void SudokuMaskBatch(__global int* arrays, __global int* outFlags, __local int* units, __local int* field, __local uint* candidates, const uint argN, const uint argCellSize)
+{
+    SUDOKU_DIMENSIONS(argN, argCellSize)
+
+    uint grid = get_group_id(0);
+    __global int* array = arrays + grid * N * N;
+
+    int index = get_local_id(1) * N + get_local_id(0);
+
+    // Load Field from global mem
+    int value = array[index];
+    field[index] = value == -1 ? 0 : value;
+
+    int setValues;
+    int unsolved = propagateMasks(field, candidates, units, N, rootN, &setValues);
+
+    // Write Field
+    array[index] = field[index];
+
+    // Write flags
+    if (index == 0)
+    {
+        outFlags[grid * 3] = unsolved < 0 ? 1 : unsolved;
+        outFlags[grid * 3 + 1] = unsolved < 0 ? 1 : 0;
+        outFlags[grid * 3 + 2] = setValues;
+    }
+}
+
+/**
+ * Same as SudokuSearch with propagateMasks, \a units needs 9 * N ints and \a candidates N * N uints.
+ * The check of full grids is part of the propagation here
+ */
+__kernel void SudokuMaskSearch(__global int* arrays, __global int* outFlags, __local int* units, __local int* field, __local uint* candidates, const uint argN, const uint argCellSize, __global int* stacks, __local int* search)
+{
+    SUDOKU_DIMENSIONS(argN, argCellSize)
+
+    uint grid = get_group_id(0);
+    uint numCells = N * N;
+    uint entrySize = numCells + 3;
+
+    __global int* array = arrays + grid * numCells;
+    __global int* stack = stacks + (size_t)grid * numCells * entrySize;
+
+    int index = get_local_id(1) * N + get_local_id(0);
+
+    if (index == 0)
+    {
+        search[0] = 0;
+        search[1] = SEARCH_RUNNING;
+        search[2] = 0;
+    }
+
+    // Load Field from global mem
+    int value = array[index];
+    field[index] = value == -1 ? 0 : value;
+
+    int unsolved;
+    while (true)
+    {
+        int setValues;
+        unsolved = propagateMasks(field, candidates, units, N, rootN, &setValues);
+        if (unsolved == 0)
+        {
+            if (index == 0)
+            {
+                search[1] = SEARCH_SOLVED;
+            }
+            break;
+        }
+
+        bool opened = false;
+        if (unsolved > 0)
+        {
+            // open a new level on the cell with fewest candidates
+            __global int* top = stack + search[0] * entrySize;
+            top[index] = field[index];
+
+            if (index == 0)
+            {
+                uint bestCell = 0;
+                uint bestCount = N + 1;
+                for (uint cell = 0; cell < numCells && bestCount > 2; ++cell)
+                {
+                    uint count = popcount(candidates[cell]);
+                    if (field[cell] == 0 && count < bestCount)
+                    {
+                        bestCell = cell;
+                        bestCount = count;
+                    }
+                }
+
+                top[numCells] = bestCell;
+                top[numCells + 1] = candidates[bestCell];
+                top[numCells + 2] = 0;
+                opened = true;
+            }
+        }
+
+        barrier(CLK_LOCAL_MEM_FENCE | CLK_GLOBAL_MEM_FENCE);
+
+        if (index == 0)
+        {
+            nextBranch(stack, search, numCells, opened);
+        }
+
+        barrier(CLK_LOCAL_MEM_FENCE | CLK_GLOBAL_MEM_FENCE);
+
+        if (search[1] == SEARCH_EXHAUSTED)
+        {
+            break;
+        }
+
+        __global int* top = stack + (search[0] - 1) * entrySize;
+        field[index] = index == top[numCells] ? top[numCells + 2] : top[index];
+    }
+
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    // Write Field
+    array[index] = field[index];
+
+    // Write flags
+    if (index == 0)
+    {
+        bool found = search[1] == SEARCH_SOLVED;
+        outFlags[grid * 3] = found ? 0 : (unsolved < 0 ? 1 : unsolved);
+        outFlags[grid * 3 + 1] = found ? 0 : 1;
+        outFlags[grid * 3 + 2] = search[2];
+    }
+}
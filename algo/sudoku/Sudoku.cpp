@@ -1,126 +1,121 @@
 #include "Sudoku.h"
+#include "SudokuField.h"
+#include "DancingLinks.h"
+#include "Bitboard9.h"
+#include "SudokuSimd.h"
+#include "SolutionCache.h"
 
+#include <algorithm>
 #include <cmath>
 #include <assert.h>
+#include <functional>
 #include <iostream>
-#include <thread>
+#include <mutex>
 #include <vector>
 #include <numeric>
 
 #include <opencv2/opencv.hpp>
 
 #include <CLUtil.h>
+#include <ThreadPool.h>
 #include <Timer.h>
 #include <Utils.h>
 
 #define EPS 1e-8
 
-class Cell
-{
-public:
-    Cell(size_t N);
-
-    /**
-     * @return -1 if invalid (no solution possible);
-     *          0 if no value set yet (multiple possibilities left)
-     *          1-N if value set
-     */
-    int value() const;
-
-    bool valid() const { return m_value > -1; }
-    bool solved() const { return m_value > 0; }
-
-    /**
-     * @brief setValue set cell to \a value if possible
-     * @return false if \a value is not in list of possiblities
-     */
-    bool setValue(int value);
-    void disable(int value);
-
-    bool possible(int value) const;
-
-    size_t possibilities() const;
-
-    operator int() const { return value(); }
+// upper bound for the device memory of the SudokuSearch stacks of one launch
+constexpr size_t MaxSearchStackBytes = size_t(256) << 20;
 
-    /**
-     * @brief solve write value if only one possibility left
-     * @return true if value was set or marked as invalid, false if more than one possibility remains
-     */
-    bool solve();
-
-private:
-    size_t m_N;
-    int m_value;
-    std::vector<bool> m_possible;
+/**
+ * @brief BranchState branching state of the search running on this thread
+ */
+struct BranchState
+{
+    // failed branches per cell (row major) for the MOST_CONFLICTS tie-break, cleared per search
+    std::vector<uint32_t> conflicts;
+    // randomizes the tie-break of the current restart, 0 in the first run
+    uint32_t seed = 0;
+    // search nodes the current restart may still set, it is cut once they are used up
+    size_t nodesLeft = SIZE_MAX;
+    bool cut = false;
 };
 
-class Field
+static thread_local BranchState branchState;
+
+/**
+ * @brief LogMute the solver tree output is not thread safe, mute it while workers are running
+ */
+class LogMute
 {
 public:
-    Field(size_t N);
-
-    /**
-     * @brief setValue set cell with coords (\a col, \a row) to \a value if possible
-     * @returns false if \a value is not in list of possiblities for cell
-     */
-    bool setValue(size_t row, size_t col, int value);
-    bool possible(size_t row, size_t col, int value) const;
-    int value(size_t row, size_t col) const;
-
-    /**
-     * @brief solveStep solve cells with only one possibility left
-     * @return if field can still be valid and number of changes in this step
-     */
-    std::tuple<bool, int> solveStep();
-
-    void print(int recursionDepth) const;
-
-    bool valid() const;
-    bool solved() const;
-    size_t numSolvedCells() const;
-
-    /**
-     * @return how many cells currently solved with \a value
-     */
-    size_t valueCount(int value) const;
-    /**
-     * @return number with the most already solved cells but not completely solved
-     */
-    size_t mostlySolvedNumber() const;
-
-    /**
-     * @brief mostSolvedCell finds yet unsolved cell with fewest remaining possiblities
-     * @param outRow row coord of cell
-     * @param outCol col coord of cell
-     * @return how many remaining possibilties
-     */
-    size_t mostSolvedCell(size_t& outRow, size_t& outCol) const;
+    LogMute(int& level) : m_level(level), m_saved(level) { m_level = 0; }
+    ~LogMute() { m_level = m_saved; }
 
 private:
-    Cell& cell(size_t row, size_t col) const;
-
-private:
-    size_t m_N;
-    std::vector<Cell> m_cells;
-
-    std::vector<std::vector<int>> m_rows;
-    std::vector<std::vector<int>> m_cols;
-    std::vector<std::vector<int>> m_blocks;
+    int& m_level;
+    int m_saved;
 };
 
-void printIndent(int recursionDepth);
-
 Sudoku::Sudoku(size_t N) : Algorithm("Sudoku"), m_N(N),
-    m_dArray(nullptr), m_Program(nullptr), m_SolverKernel(nullptr), m_logLevel(1)
+    m_dArray(nullptr), m_dBatchArray(nullptr), m_dBatchFlags(nullptr), m_batchCapacity(0),
+    m_dSearchStacks(nullptr), m_stackCapacity(0),
+    m_Program(nullptr), m_SolverKernel(nullptr), m_BatchKernel(nullptr), m_SearchKernel(nullptr),
+    m_MaskBatchKernel(nullptr), m_MaskSearchKernel(nullptr), m_logLevel(1),
+    m_deductions(0), m_simd(false), m_valueHint(nullptr), m_budgetActive(false), m_nodeBudget(0), m_solutionCount(0), m_workerStats(1), m_throughput(0.0)
 {
     ContainerSpecification input("in_grid", ContainerSpecification::READ_ONLY);
     ContainerSpecification output("out_grid", ContainerSpecification::REFERENCE);
+    ContainerSpecification alternatives("in_alternatives", ContainerSpecification::READ_ONLY, ContainerSpecification::GENERIC, true);
     m_argumentsSpecification.push_back(input);
     m_argumentsSpecification.push_back(output);
-
-    // only square numbers are allowed for N, otherwise we cant have blocks
-    assert(sqrt(m_N) == std::trunc(sqrt(m_N)));
+    m_argumentsSpecification.push_back(alternatives);
+
+    m_settings.add(Option("batchMode", OptionValue<bool>(false, false)));
+    m_settings.add(Option("threads", OptionValue<int>(0, 0, 0, 256)));
+    m_settings.add(Option("parallelSearch", OptionValue<bool>(false, false)));
+    m_settings.add(Option("trailSearch", OptionValue<bool>(false, false)));
+    // count solutions up to this cap instead of stopping at the first one, 2 checks for a unique solution (CPU only)
+    m_settings.add(Option("solutionCap", OptionValue<int>(0, 0, 0, 1 << 20)));
+    // exec() keeps the solutions of this many puzzles and answers repeated puzzles from the cache
+    m_settings.add(Option("solutionCache", OptionValue<int>(0, 0, 0, 1 << 20)));
+    // puzzles that only differ by transposition, band/stack order or digit labels share one cache entry
+    m_settings.add(Option("cacheSymmetry", OptionValue<bool>(false, false)));
+    // exec(), resolve() and countSolutions() give up on a grid after this many ms or search nodes, 0 is unlimited
+    m_settings.add(Option("timeBudget", OptionValue<int>(0, 0, 0, 1 << 20)));
+    m_settings.add(Option("nodeBudget", OptionValue<int>(0, 0, 0, 1 << 30)));
+    // givens exec() may replace by an OCR alternative (in_alternatives) if the grid has no solution, 0 disables
+    m_settings.add(Option("ocrFlips", OptionValue<int>(2, 2, 0, 8)));
+    // a given is uncertain if an alternative scores at least this fraction of the recognized digit
+    m_settings.add(Option("ocrRatio", OptionValue<double>(0.8, 0.8, 0.0, 1.0)));
+
+    // propagation rules in addition to naked and hidden singles
+    m_settings.add(Option("nakedPairs", OptionValue<bool>(false, false)));
+    m_settings.add(Option("hiddenPairs", OptionValue<bool>(false, false)));
+    m_settings.add(Option("pointingPairs", OptionValue<bool>(false, false)));
+    m_settings.add(Option("boxLineReduction", OptionValue<bool>(false, false)));
+    m_settings.add(Option("xWing", OptionValue<bool>(false, false)));
+
+    // tie-break between the cells with the fewest candidates: 0 first cell, 1 most unsolved peers, 2 most failed branches
+    m_settings.add(Option("branchCell", OptionValue<int>(0, 0, 0, 2)));
+    // try the values possible in the fewest other cells of the row, column and block first
+    m_settings.add(Option("leastConstrainingValue", OptionValue<bool>(false, false)));
+    // start the trail search over with randomized tie-breaks after "restartNodes" nodes, the limit doubles per restart
+    m_settings.add(Option("restarts", OptionValue<int>(0, 0, 0, 64)));
+    m_settings.add(Option("restartNodes", OptionValue<int>(100, 100, 1, 1 << 20)));
+
+    // vectorized singles for 9x9, only used if the CPU supports AVX2
+    m_settings.add(Option("simdPropagation", OptionValue<bool>(true, true)));
+    // propagate batches of 9x9 grids side by side in vector lanes, needs simdPropagation
+    m_settings.add(Option("lockstepBatch", OptionValue<bool>(true, true)));
+    // grids per launch of the batched kernel, 0 launches the single grid kernel for every search node
+    m_settings.add(Option("gpuBatchSize", OptionValue<int>(256, 256, 0, 65536)));
+    // backtrack on the device, otherwise every search node of a batch is a round trip to the host
+    m_settings.add(Option("gpuSearch", OptionValue<bool>(true, true)));
+    // batched kernels keep the candidates of a cell in one uint and need a few barriers per propagation round only
+    m_settings.add(Option("gpuBitmask", OptionValue<bool>(true, true)));
+
+    // throws for sizes without a specialized Field<N>
+    withFieldSize(m_N, [](auto) {});
 
     // How many bytes are needed to store flags for each possible number
     m_possArrayCellSize = static_cast<unsigned int>(ceil(double(m_N) / 8.0));
@@ -136,11 +131,66 @@ void Sudoku::setLogLevel(int level)
     m_logLevel = level;
 }
 
+void Sudoku::setStopToken(std::stop_token token)
+{
+    m_stopToken = std::move(token);
+}
+
+bool Sudoku::budgetExceeded() const
+{
+    return m_budgetExceeded;
+}
+
+void Sudoku::startBudget()
+{
+    const int timeBudget = m_settings.get("timeBudget").valueInt().value();
+    m_nodeBudget = m_settings.get("nodeBudget").valueInt().value();
+    m_deadline = timeBudget > 0 ? std::chrono::steady_clock::now() + std::chrono::milliseconds(timeBudget)
+                                : std::chrono::steady_clock::time_point::max();
+    m_budgetActive = timeBudget > 0 || m_nodeBudget > 0 || m_stopToken.stop_possible();
+    m_budgetNodes = 0;
+    m_budgetExceeded = m_stopToken.stop_requested();
+}
+
+bool Sudoku::exhausted()
+{
+    if (m_budgetExceeded.load(std::memory_order_relaxed))
+    {
+        return true;
+    }
+    if (!m_budgetActive)
+    {
+        return false;
+    }
+
+    // the clock and the stop token are looked at every 16 nodes only
+    size_t nodes = m_budgetNodes.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (m_nodeBudget > 0 && nodes > m_nodeBudget)
+    {
+        m_budgetExceeded = true;
+    }
+    return (nodes % 16 == 0 && budgetExpired()) || m_budgetExceeded;
+}
+
+bool Sudoku::budgetExpired()
+{
+    if (m_stopToken.stop_requested() || (m_budgetActive && std::chrono::steady_clock::now() >= m_deadline))
+    {
+        m_budgetExceeded = true;
+    }
+    return m_budgetExceeded;
+}
+
 std::vector<Algorithm::ImplementationType> Sudoku::supportedImplementations() const
 {
     std::vector<Algorithm::ImplementationType> v;
     v.push_back(CPU);
-    v.push_back(GPU);
+    // the kernels use a work group of N*N items and 32 bit candidate masks
+    if (m_N <= 25)
+        v.push_back(GPU);
+    v.push_back(CPU_EXACT_COVER);
+    if (m_N == 9)
+        v.push_back(CPU_BITBOARD);
     return v;
 }
 
@@ -151,11 +201,39 @@ bool Sudoku::exec()
         m_activeImpl = CPU;
     }
 
-    std::cout << "Start solver" << std::endl;
+    if (m_settings.get("batchMode").valueBool().value())
+    {
+        return execBatch();
+    }
+
+    if (m_logLevel > 0)
+    {
+        std::cout << "Start solver" << std::endl;
+    }
+
+    m_deductions = deductionsFromSettings();
+    m_simd = m_settings.get("simdPropagation").valueBool().value() && SudokuSimd::supported();
+    m_branching = branchingFromSettings();
+    resetStats();
+    m_solutionCounts.clear();
+    m_correctedGivens.clear();
+
+    const size_t solutionCap = m_settings.get("solutionCap").valueInt().value();
+    const size_t cacheSize = m_settings.get("solutionCache").valueInt().value();
+    const bool cacheSymmetry = m_settings.get("cacheSymmetry").valueBool().value();
+    if (cacheSize == 0)
+    {
+        m_cache.reset();
+    }
+    else if (!m_cache || m_cache->capacity() != cacheSize || m_cache->symmetry() != cacheSymmetry)
+    {
+        m_cache = std::make_unique<SolutionCache>(m_N, cacheSize, cacheSymmetry);
+    }
 
     std::vector<double> runtimes;
 
     auto input = m_arguments[0];
+    auto alternativesInput = m_arguments.size() > 2 ? m_arguments[2] : nullptr;
     for (size_t s = 0; s < input->size(); ++s)
     {
         auto sudoku = input->get(s);
@@ -171,20 +249,68 @@ bool Sudoku::exec()
             throw std::runtime_error("Invalid input size");
         }
 
+        std::vector<int>& result = m_activeImpl == ImplementationType::GPU ? m_hResultGPU : m_hResultCPU;
+        std::vector<int> cached(m_hArray.size());
+        std::vector<int>& corrected = m_correctedGivens.emplace_back();
+
         Timer timer;
 
-        for (int i = 0; i < m_iterations; ++i)
+        if (m_cache && m_cache->find(m_hArray.data(), cached.data()))
+        {
+            result = cached;
+            m_solutionCount = 1;
+            runtimes.push_back(timer.elapsed());
+        }
+        else
         {
-            DoCompute();
+            result.clear();
+            for (int i = 0; i < m_iterations; ++i)
+            {
+                startBudget();
+                DoCompute();
+            }
+
+            // a misread digit makes the grid contradictory, retry with the OCR alternatives of uncertain givens
+            if (result.empty() && !m_budgetExceeded && alternativesInput && alternativesInput->size() > s)
+            {
+                std::vector<Alternatives> alternatives = alternativesFromMat(*alternativesInput->get(s));
+                if (alternatives.empty() && m_logLevel > 0)
+                {
+                    std::cout << std::format("No usable OCR alternatives for the {}x{} grid", m_N, m_N) << std::endl;
+                }
+                std::vector<int> givens(m_hArray.size()), solution(m_hArray.size());
+                if (!alternatives.empty() && solveTolerant(m_hArray.data(), alternatives, solution.data(), givens.data()))
+                {
+                    result = solution;
+                    corrected = givens;
+                }
+            }
+            runtimes.push_back(timer.elapsed() / double(m_iterations));
+
+            if (result.empty() && m_budgetExceeded)
+            {
+                ++localStats().budgetExceeded;
+            }
+
+            // with solution counting only unique puzzles are cached, a tolerant solution
+            // belongs to the corrected givens and not to the contradictory recognized ones
+            if (m_cache && !result.empty() && (solutionCap == 0 || m_solutionCount == 1))
+            {
+                m_cache->insert(corrected.empty() ? m_hArray.data() : corrected.data(), result.data());
+            }
         }
+        localStats().latency.record(runtimes.back());
 
-        runtimes.push_back(timer.elapsed() / double(m_iterations));
+        if (m_activeImpl == ImplementationType::CPU && solutionCap > 0)
+        {
+            m_solutionCounts.push_back(m_solutionCount);
+        }
 
         auto output = std::make_shared<cv::Mat>();
-        if (m_activeImpl == ImplementationType::CPU)
-            cv::Mat(m_hResultCPU).copyTo(*output);
-        else if (m_activeImpl == ImplementationType::GPU)
+        if (m_activeImpl == ImplementationType::GPU)
             cv::Mat(m_hResultGPU).copyTo(*output);
+        else
+            cv::Mat(m_hResultCPU).copyTo(*output);
 
         m_arguments[1]->add(output);
     }
@@ -199,134 +325,1163 @@ bool Sudoku::exec()
         m_runtime /= runtimes.size();
     }
 
-    std::cout << "solver finished" << std::endl;
+    collectStats();
+    if (m_logLevel > 0)
+    {
+        std::cout << "solver finished: " << m_stats.summary() << std::endl;
+    }
 
     return true;
 }
 
-bool Sudoku::InitResources(cl_device_id Device, cl_context Context, cl_command_queue CommandQueue)
+bool Sudoku::execBatch()
 {
-    Algorithm::InitResources(Device, Context, CommandQueue);
+    const size_t numCells = m_N * m_N;
 
-    //device resources
-    cl_int clError, clError2;
-    m_dArray = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_int) * m_N * m_N, nullptr, &clError2);
-    clError = clError2;
-    m_dDebugArray = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * m_N * m_N, nullptr, &clError2);
-    clError = clError2;
-    m_dFlags = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_int) * 3, nullptr, &clError2);
-    clError = clError2;
-    CLUtil::handleCLErrors(clError, "Error allocating device arrays");
+    auto input = m_arguments[0];
+    std::vector<int> grids;
+    size_t count = 0;
+    for (size_t s = 0; s < input->size(); ++s)
+    {
+        auto sudoku = input->get(s);
 
-    m_Program = CLUtil::compileProgram(Device, Context, Utils::loadFile("algo/sudoku/Sudoku.cl"));
-    if(m_Program == nullptr) return false;
+        if (sudoku->empty())
+        {
+            continue;
+        }
 
-    //create kernels
-    m_SolverKernel = clCreateKernel(m_Program, "Sudoku", &clError);
-    CLUtil::handleCLErrors(clError, "Failed to create kernel: Sudoku.");
+        std::vector<int> grid(*sudoku);
+        if (grid.size() != numCells)
+        {
+            throw std::runtime_error("Invalid input size");
+        }
+
+        grids.insert(grids.end(), grid.begin(), grid.end());
+        ++count;
+    }
+
+    std::vector<int> results(grids.size());
+    size_t solved = 0;
+
+    Timer timer;
+
+    for (int i = 0; i < m_iterations; ++i)
+    {
+        solved = solveBatch(grids.data(), results.data(), count);
+    }
+
+    m_runtime = count > 0 ? timer.elapsed() / double(m_iterations * count) : 0.0;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        auto output = std::make_shared<cv::Mat>();
+        auto begin = results.begin() + i * numCells;
+        if (*begin > 0)
+        {
+            cv::Mat(std::vector<int>(begin, begin + numCells)).copyTo(*output);
+        }
+
+        m_arguments[1]->add(output);
+    }
+
+    if (m_logLevel > 0)
+    {
+        std::cout << std::format("Batch solved {} of {} grids on {} threads ({} grids/s)",
+                                 solved, count, m_pool ? m_pool->size() : 0, static_cast<size_t>(m_throughput)) << std::endl;
+        std::cout << m_stats.summary() << std::endl;
+    }
 
     return true;
 }
 
-void Sudoku::ReleaseResources()
-{
-    if (m_dArray) clReleaseMemObject(m_dArray);
-    if (m_SolverKernel) clReleaseKernel(m_SolverKernel);
-    if (m_Program) clReleaseProgram(m_Program);
-}
+size_t Sudoku::solveBatch(const int* grids, int* outGrids, size_t count)
+{
+    if (!m_implSet)
+    {
+        m_activeImpl = CPU;
+    }
+
+    // grids of a batch have no budget, a stop request skips the remaining ones
+    m_budgetActive = false;
+    m_budgetExceeded = false;
+
+    if (m_activeImpl == ImplementationType::GPU)
+    {
+        resetStats();
+
+        LogMute mute(m_logLevel);
+
+        Timer timer;
+        size_t solved = withFieldSize(m_N, [&](auto n) { return solveGPU<n>(grids, outGrids, count, &localStats().latency); });
+
+        double elapsed = timer.elapsed();
+        m_throughput = elapsed > 0.0 ? double(count) / (elapsed / 1000.0) : 0.0;
+
+        collectStats();
+        return solved;
+    }
+
+    ThreadPool& pool = threadPool();
+
+    const bool exactCover = m_activeImpl == ImplementationType::CPU_EXACT_COVER;
+    const bool bitboard = m_activeImpl == ImplementationType::CPU_BITBOARD;
+    const bool trail = m_settings.get("trailSearch").valueBool().value();
+    if (exactCover)
+    {
+        while (m_workerExactCover.size() < pool.size())
+        {
+            m_workerExactCover.push_back(std::make_unique<DancingLinks>(m_N));
+        }
+    }
+    if (bitboard)
+    {
+        while (m_workerBitboard.size() < pool.size())
+        {
+            m_workerBitboard.push_back(std::make_unique<Bitboard9>());
+        }
+    }
+
+    const size_t numCells = m_N * m_N;
+    std::atomic<size_t> solved = 0;
+
+    m_deductions = deductionsFromSettings();
+    m_simd = m_settings.get("simdPropagation").valueBool().value() && SudokuSimd::supported();
+    m_branching = branchingFromSettings();
+    resetStats();
+
+    const bool lockstep = !exactCover && !bitboard && m_N == 9 && m_simd && m_settings.get("lockstepBatch").valueBool().value();
+
+    LogMute mute(m_logLevel);
+
+    Timer timer;
+
+    if (lockstep)
+    {
+        const size_t numGroups = (count + SudokuSimd::BatchSize - 1) / SudokuSimd::BatchSize;
+        pool.parallelFor(numGroups, [&](size_t group, size_t)
+        {
+            size_t first = group * SudokuSimd::BatchSize;
+            size_t n = std::min(SudokuSimd::BatchSize, count - first);
+            if (m_stopToken.stop_requested())
+            {
+                std::fill(outGrids + first * numCells, outGrids + (first + n) * numCells, 0);
+                localStats().budgetExceeded += n;
+                return;
+            }
+            solved.fetch_add(solveLockstep(grids + first * numCells, outGrids + first * numCells, n, trail),
+                             std::memory_order_relaxed);
+        }, std::max<size_t>(1, numGroups / (pool.size() * 16)));
+    }
+    else
+    {
+        withFieldSize(m_N, [&](auto n)
+        {
+            pool.parallelFor(count, [&](size_t i, size_t worker)
+            {
+                const int* grid = grids + i * numCells;
+                int* outGrid = outGrids + i * numCells;
+
+                if (m_stopToken.stop_requested())
+                {
+                    std::fill(outGrid, outGrid + numCells, 0);
+                    ++localStats().budgetExceeded;
+                    return;
+                }
+
+                Timer gridTimer;
+                bool success;
+                if (exactCover)
+                {
+                    std::copy(grid, grid + numCells, outGrid);
+                    success = m_workerExactCover[worker]->solve(outGrid);
+                    localStats().searchNodes += m_workerExactCover[worker]->nodes();
+                }
+                else if (bitboard)
+                {
+                    std::copy(grid, grid + numCells, outGrid);
+                    success = m_workerBitboard[worker]->solve(outGrid);
+                    localStats().searchNodes += m_workerBitboard[worker]->nodes();
+                }
+                else
+                {
+                    success = solveGrid<n>(grid, outGrid, trail);
+                }
+                localStats().latency.record(gridTimer.elapsed());
+
+                if (success)
+                {
+                    solved.fetch_add(1, std::memory_order_relaxed);
+                }
+                else
+                {
+                    std::fill(outGrid, outGrid + numCells, 0);
+                }
+            }, std::max<size_t>(1, count / (pool.size() * 16)));
+        });
+    }
+
+    double elapsed = timer.elapsed();
+    m_throughput = elapsed > 0.0 ? double(count) / (elapsed / 1000.0) : 0.0;
+
+    collectStats();
+    return solved;
+}
+
+double Sudoku::throughput() const
+{
+    return m_throughput;
+}
+
+size_t Sudoku::countSolutions(const int* grid, size_t cap, int* outSolution)
+{
+    m_deductions = deductionsFromSettings();
+    m_simd = m_settings.get("simdPropagation").valueBool().value() && SudokuSimd::supported();
+    m_branching = branchingFromSettings();
+    resetStats();
+    startBudget();
+
+    Timer timer;
+    size_t count = withFieldSize(m_N, [&](auto n) -> size_t
+    {
+        Field<n> f;
+        for (size_t i = 0; i < n * n; ++i)
+        {
+            if (grid[i] > 0 && !f.setValue(i / n, i % n, grid[i]))
+            {
+                return 0;
+            }
+        }
+        return countField(f, std::max<size_t>(cap, 1), outSolution);
+    });
+    localStats().latency.record(timer.elapsed());
+    if (m_budgetExceeded)
+    {
+        ++localStats().budgetExceeded;
+    }
+
+    collectStats();
+    return count;
+}
+
+bool Sudoku::resolve(const int* previousGrid, const int* previousSolution, const std::vector<GivenChange>& changes, int* outSolution)
+{
+    const size_t numCells = m_N * m_N;
+
+    std::vector<int> grid(previousGrid, previousGrid + numCells);
+    bool consistent = previousSolution != nullptr && previousSolution[0] > 0;
+    bool additions = true;
+    for (const GivenChange& change : changes)
+    {
+        if (change.cell >= numCells)
+        {
+            throw std::runtime_error("Invalid cell of given change");
+        }
+        if (change.value > int(m_N))
+        {
+            throw std::runtime_error("Invalid value of given change");
+        }
+
+        // removed givens keep the old solution valid, new ones have to agree with it
+        consistent = consistent && (change.value <= 0 || previousSolution[change.cell] == change.value);
+        additions &= grid[change.cell] <= 0;
+        grid[change.cell] = std::max(change.value, 0);
+    }
+
+    resetStats();
+    startBudget();
+    Timer timer;
+
+    bool success = true;
+    if (consistent)
+    {
+        std::copy(previousSolution, previousSolution + numCells, outSolution);
+    }
+    else
+    {
+        m_deductions = deductionsFromSettings();
+        m_simd = m_settings.get("simdPropagation").valueBool().value() && SudokuSimd::supported();
+        m_branching = branchingFromSettings();
+
+        // added givens only narrow the candidates, so the propagated state of the previous grid stays valid
+        bool reuse = additions && m_resolveField && std::equal(m_resolveGrid.begin(), m_resolveGrid.end(), previousGrid);
+
+        success = withFieldSize(m_N, [&](auto n) { return resolveField<n>(grid.data(), reuse, previousSolution, outSolution); });
+    }
+
+    localStats().latency.record(timer.elapsed());
+    if (!success && m_budgetExceeded)
+    {
+        ++localStats().budgetExceeded;
+    }
+    collectStats();
+
+    if (m_logLevel > 0)
+    {
+        std::cout << std::format("Resolve after {} changed givens: {}", changes.size(),
+                                 consistent ? "previous solution still valid" : success ? "solved" : m_budgetExceeded ? "unsolved within budget" : "could not solve") << std::endl;
+    }
+    return success;
+}
+
+template<size_t N>
+bool Sudoku::resolveField(const int* grid, bool reuse, const int* hint, int* outSolution)
+{
+    Field<N> f;
+    if (reuse)
+    {
+        f = *std::static_pointer_cast<Field<N>>(m_resolveField);
+    }
+
+    for (size_t i = 0; i < N * N; ++i)
+    {
+        if (grid[i] <= 0 || f.value(i / N, i % N) == grid[i])
+        {
+            continue;
+        }
+
+        if (f.value(i / N, i % N) > 0 || !f.setValue(i / N, i % N, grid[i]))
+        {
+            return false;
+        }
+    }
+
+    if (!propagate(f, 0))
+    {
+        return false;
+    }
+
+    m_resolveField = std::make_shared<Field<N>>(f);
+    m_resolveGrid.assign(grid, grid + N * N);
+
+    Field<N> fResult;
+    m_valueHint = hint;
+    bool success = solveWithTrail(f, fResult);
+    m_valueHint = nullptr;
+
+    if (success)
+    {
+        for (size_t i = 0; i < N * N; ++i)
+        {
+            outSolution[i] = fResult.value(i / N, i % N);
+        }
+    }
+    return success;
+}
+
+std::vector<Sudoku::Alternatives> Sudoku::alternativesFromMat(const cv::Mat& mat) const
+{
+    std::vector<Alternatives> alternatives;
+    if (mat.empty() || mat.type() != CV_64FC2 || mat.rows != int(m_N * m_N))
+    {
+        return alternatives;
+    }
+
+    alternatives.resize(mat.rows);
+    for (int cell = 0; cell < mat.rows; ++cell)
+    {
+        for (int a = 0; a < mat.cols; ++a)
+        {
+            const cv::Vec2d& entry = mat.at<cv::Vec2d>(cell, a);
+            if (entry[0] > 0)
+            {
+                alternatives[cell].push_back({static_cast<int>(entry[0]), entry[1]});
+            }
+        }
+    }
+    return alternatives;
+}
+
+bool Sudoku::solveTolerant(const int* grid, const std::vector<Alternatives>& alternatives, int* outSolution, int* outGrid)
+{
+    if (alternatives.size() != m_N * m_N)
+    {
+        throw std::runtime_error("Invalid number of OCR alternatives");
+    }
+
+    const size_t maxFlips = m_settings.get("ocrFlips").valueInt().value();
+    const double ratio = m_settings.get("ocrRatio").valueDouble().value();
+
+    m_deductions = deductionsFromSettings();
+    m_simd = m_settings.get("simdPropagation").valueBool().value() && SudokuSimd::supported();
+    m_branching = branchingFromSettings();
+    startBudget();
+
+    size_t flips = 0;
+    bool success = withFieldSize(m_N, [&](auto n)
+    {
+        return solveTolerant<n>(grid, alternatives, maxFlips, ratio, flips, outSolution, outGrid);
+    });
+
+    if (m_logLevel > 0)
+    {
+        std::cout << (success ? std::format("Solved after replacing {} recognized digit(s)", flips)
+                              : std::format("No solution with up to {} replaced digit(s)", maxFlips)) << std::endl;
+    }
+    return success;
+}
+
+template<size_t N>
+bool Sudoku::solveTolerant(const int* grid, const std::vector<Alternatives>& alternatives, size_t maxFlips, double ratio,
+                           size_t& outFlips, int* outSolution, int* outGrid)
+{
+    // givens with a close OCR alternative, the recognized digit first, then the alternatives by score
+    std::vector<std::pair<size_t, std::vector<int>>> uncertain;
+    Field<N> f;
+    for (size_t i = 0; i < N * N; ++i)
+    {
+        if (grid[i] <= 0)
+        {
+            continue;
+        }
+
+        std::vector<int> values{grid[i]};
+        auto recognized = std::ranges::find_if(alternatives[i], [&](const Alternative& a) { return a.value == grid[i]; });
+        double score = recognized != alternatives[i].end() ? recognized->score : 0.0;
+        for (const Alternative& a : alternatives[i])
+        {
+            if (a.value != grid[i] && a.value > 0 && a.value <= int(N) && a.score >= ratio * score)
+            {
+                values.push_back(a.value);
+            }
+        }
+
+        if (values.size() > 1)
+        {
+            uncertain.emplace_back(i, std::move(values));
+        }
+        else if (!f.setValue(i / N, i % N, grid[i]))
+        {
+            // the certain givens contradict each other
+            return false;
+        }
+    }
+
+    static thread_local typename Field<N>::Trail trail;
+    trail.clear();
+    f.setTrail(&trail);
+
+    // the fewest replacements first, all combinations share the propagation of the certain givens and their common prefix
+    bool success = false;
+    for (outFlips = 0; outFlips <= std::min(maxFlips, uncertain.size()) && !success && !m_budgetExceeded; ++outFlips)
+    {
+        success = assignUncertain(f, uncertain, 0, outFlips);
+    }
+    --outFlips;
+    f.setTrail(nullptr);
+
+    if (success)
+    {
+        for (size_t i = 0; i < N * N; ++i)
+        {
+            outSolution[i] = f.value(i / N, i % N);
+            if (outGrid)
+                outGrid[i] = grid[i] > 0 ? outSolution[i] : 0;
+        }
+    }
+    return success;
+}
+
+template<size_t N>
+bool Sudoku::assignUncertain(Field<N>& f, const std::vector<std::pair<size_t, std::vector<int>>>& uncertain, size_t next, size_t flips)
+{
+    if (!propagate(f, 0))
+    {
+        return false;
+    }
+
+    if (next == uncertain.size())
+    {
+        return flips == 0 && solveTrialTrail(f, 1);
+    }
+
+    const auto& [cell, values] = uncertain[next];
+    for (size_t v = 0; v < values.size(); ++v)
+    {
+        // the recognized digit costs nothing, every alternative one replacement
+        size_t cost = v > 0 ? 1 : 0;
+        if (cost > flips || flips - cost > uncertain.size() - next - 1)
+        {
+            continue;
+        }
+
+        // the propagation of the other givens may have decided the cell already
+        int decided = f.value(cell / N, cell % N);
+        if (decided > 0 ? decided != values[v] : !f.possible(cell / N, cell % N, values[v]))
+        {
+            continue;
+        }
+
+        size_t checkpoint = f.checkpoint();
+        if (decided <= 0)
+            f.setValue(cell / N, cell % N, values[v]);
+        if (assignUncertain(f, uncertain, next + 1, flips - cost))
+        {
+            return true;
+        }
+        f.rollback(checkpoint);
+    }
+    return false;
+}
+
+const std::vector<size_t>& Sudoku::solutionCounts() const
+{
+    return m_solutionCounts;
+}
+
+const std::vector<std::vector<int>>& Sudoku::correctedGivens() const
+{
+    return m_correctedGivens;
+}
+
+const SolutionCache* Sudoku::solutionCache() const
+{
+    return m_cache.get();
+}
+
+size_t Sudoku::searchNodes() const
+{
+    return m_stats.searchNodes;
+}
+
+const SolverStats& Sudoku::stats() const
+{
+    return m_stats;
+}
+
+unsigned Sudoku::deductionsFromSettings()
+{
+    unsigned deductions = 0;
+    if (m_settings.get("nakedPairs").valueBool().value())
+        deductions |= NAKED_PAIRS;
+    if (m_settings.get("hiddenPairs").valueBool().value())
+        deductions |= HIDDEN_PAIRS;
+    if (m_settings.get("pointingPairs").valueBool().value())
+        deductions |= POINTING_PAIRS;
+    if (m_settings.get("boxLineReduction").valueBool().value())
+        deductions |= BOX_LINE_REDUCTION;
+    if (m_settings.get("xWing").valueBool().value())
+        deductions |= X_WING;
+    return deductions;
+}
+
+Sudoku::Branching Sudoku::branchingFromSettings()
+{
+    Branching branching;
+    branching.cell = m_settings.get("branchCell").valueInt().value();
+    branching.leastConstraining = m_settings.get("leastConstrainingValue").valueBool().value();
+    branching.restarts = m_settings.get("restarts").valueInt().value();
+    branching.restartNodes = m_settings.get("restartNodes").valueInt().value();
+    return branching;
+}
+
+template<size_t N>
+void Sudoku::branchCell(const Field<N>& f, size_t& outRow, size_t& outCol)
+{
+    BranchState& state = branchState;
+    if (m_branching.cell == MOST_CONFLICTS && state.conflicts.size() != N * N)
+    {
+        state.conflicts.assign(N * N, 0);
+    }
+    f.branchCell(BranchCell(m_branching.cell), state.conflicts.data(), state.seed, outRow, outCol);
+}
+
+template<size_t N>
+void Sudoku::addConflict(size_t row, size_t col)
+{
+    if (m_branching.cell == MOST_CONFLICTS)
+    {
+        ++branchState.conflicts[N * row + col];
+    }
+}
+
+ThreadPool& Sudoku::threadPool()
+{
+    if (!m_pool)
+    {
+        m_pool = std::make_unique<ThreadPool>(m_settings.get("threads").valueInt().value());
+        m_workerStats.resize(m_pool->size() + 1);
+    }
+
+    return *m_pool;
+}
+
+SolverStats& Sudoku::localStats()
+{
+    return m_workerStats[(m_pool ? m_pool->currentWorker() : -1) + 1];
+}
+
+void Sudoku::resetStats()
+{
+    m_workerStats.assign((m_pool ? m_pool->size() : 0) + 1, SolverStats());
+    m_stats = SolverStats();
+}
+
+void Sudoku::collectStats()
+{
+    m_stats = SolverStats();
+    for (const SolverStats& stats : m_workerStats)
+    {
+        m_stats.merge(stats);
+    }
+}
+
+bool Sudoku::InitResources(cl_device_id Device, cl_context Context, cl_command_queue CommandQueue)
+{
+    Algorithm::InitResources(Device, Context, CommandQueue);
+
+    //device resources
+    cl_int clError, clError2;
+    m_dArray = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_int) * m_N * m_N, nullptr, &clError2);
+    clError = clError2;
+    m_dDebugArray = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_uint) * m_N * m_N, nullptr, &clError2);
+    clError = clError2;
+    m_dFlags = clCreateBuffer(Context, CL_MEM_READ_WRITE, sizeof(cl_int) * 3, nullptr, &clError2);
+    clError = clError2;
+    CLUtil::handleCLErrors(clError, "Error allocating device arrays");
+
+    // the grid size is compiled into the kernels, every size builds its own program once
+    const unsigned rootN = static_cast<unsigned>(std::lround(std::sqrt(m_N)));
+    const std::string options = std::format("-DSUDOKU_N={} -DSUDOKU_ROOT_N={}", m_N, rootN);
+    m_Program = CLUtil::cachedProgram(Device, Context, Utils::loadFile("algo/sudoku/Sudoku.cl"), options);
+    if(m_Program == nullptr) return false;
+
+    //create kernels
+    m_SolverKernel = clCreateKernel(m_Program, "Sudoku", &clError);
+    CLUtil::handleCLErrors(clError, "Failed to create kernel: Sudoku.");
+    m_BatchKernel = clCreateKernel(m_Program, "SudokuBatch", &clError);
+    CLUtil::handleCLErrors(clError, "Failed to create kernel: SudokuBatch.");
+    m_SearchKernel = clCreateKernel(m_Program, "SudokuSearch", &clError);
+    CLUtil::handleCLErrors(clError, "Failed to create kernel: SudokuSearch.");
+    m_MaskBatchKernel = clCreateKernel(m_Program, "SudokuMaskBatch", &clError);
+    CLUtil::handleCLErrors(clError, "Failed to create kernel: SudokuMaskBatch.");
+    m_MaskSearchKernel = clCreateKernel(m_Program, "SudokuMaskSearch", &clError);
+    CLUtil::handleCLErrors(clError, "Failed to create kernel: SudokuMaskSearch.");
+
+    return true;
+}
+
+void Sudoku::ReleaseResources()
+{
+    if (m_dArray) clReleaseMemObject(m_dArray);
+    if (m_dBatchArray) clReleaseMemObject(m_dBatchArray);
+    if (m_dBatchFlags) clReleaseMemObject(m_dBatchFlags);
+    if (m_dSearchStacks) clReleaseMemObject(m_dSearchStacks);
+    if (m_SolverKernel) clReleaseKernel(m_SolverKernel);
+    if (m_BatchKernel) clReleaseKernel(m_BatchKernel);
+    if (m_SearchKernel) clReleaseKernel(m_SearchKernel);
+    if (m_MaskBatchKernel) clReleaseKernel(m_MaskBatchKernel);
+    if (m_MaskSearchKernel) clReleaseKernel(m_MaskSearchKernel);
+    if (m_Program) clReleaseProgram(m_Program);
+}
+
+bool Sudoku::ValidateResults()
+{
+    for (size_t i = 0; i < m_N * m_N; ++i)
+    {
+        if (m_hResultCPU[i] != m_hResultGPU[i])
+            return false;
+    }
+
+    return true;
+}
+
+void Sudoku::DoCompute()
+{
+    if (m_activeImpl == ImplementationType::CPU_EXACT_COVER)
+    {
+        if (!m_exactCover)
+            m_exactCover = std::make_unique<DancingLinks>(m_N);
+        DoComputeSolver(*m_exactCover);
+        return;
+    }
+
+    if (m_activeImpl == ImplementationType::CPU_BITBOARD)
+    {
+        if (!m_bitboard)
+            m_bitboard = std::make_unique<Bitboard9>();
+        DoComputeSolver(*m_bitboard);
+        return;
+    }
+
+    withFieldSize(m_N, [this](auto n) { DoCompute<n>(); });
+}
+
+template<size_t N>
+void Sudoku::DoCompute()
+{
+    Field<N> f, fResult;
+    m_solutionCount = 0;
+    // a given that contradicts an earlier one (e.g. a misread digit) makes the whole grid invalid,
+    // so exec() can retry with the OCR alternatives instead of solving a grid without it
+    bool valid = true;
+    for (size_t row = 0; row < N && valid; ++row)
+    {
+        for (size_t col = 0; col < N && valid; ++col)
+        {
+            int val = m_hArray[row * N + col];
+            if (val > 0)
+            {
+                valid = f.setValue(row, col, val);
+            }
+        }
+    }
+
+    if (!valid)
+    {
+        if (m_logLevel > 0)
+        {
+            std::cout << "Invalid input" << std::endl;
+            f.print(0);
+        }
+        return;
+    }
+
+    // 17 is the proven minimum number of clues for a unique 9x9 solution
+    if (N == 9 && f.numSolvedCells() < 17)
+    {
+        if (m_logLevel > 0)
+            std::cout << "Skip grid with too few values (" << f.numSolvedCells() << ")" << std::endl;
+        return;
+    }
+
+    if (m_logLevel > 0)
+        f.print(0);
+
+    bool cpu = m_activeImpl == ImplementationType::CPU;
+    size_t solutionCap = m_settings.get("solutionCap").valueInt().value();
+    bool success;
+    if (!cpu && m_settings.get("gpuBatchSize").valueInt().value() > 0)
+    {
+        std::vector<int> grid(N * N), solution(N * N);
+        for (size_t i = 0; i < N * N; ++i)
+        {
+            grid[i] = f.value(i / N, i % N);
+        }
+
+        success = solveGPU<N>(grid.data(), solution.data(), 1) > 0;
+        for (size_t i = 0; success && i < N * N; ++i)
+        {
+            fResult.setValue(i / N, i % N, solution[i]);
+        }
+    }
+    else if (cpu && solutionCap > 0)
+    {
+        std::vector<int> solution(N * N);
+        m_solutionCount = countField(f, solutionCap, solution.data());
+        if (m_solutionCount > 1 && m_logLevel > 0)
+        {
+            std::cout << "Puzzle has more than one solution" << std::endl;
+        }
+
+        success = m_solutionCount > 0;
+        for (size_t i = 0; success && i < N * N; ++i)
+        {
+            fResult.setValue(i / N, i % N, solution[i]);
+        }
+    }
+    else if (cpu && m_settings.get("parallelSearch").valueBool().value())
+        success = solveParallel(f, fResult);
+    // fields above 25x25 are too large to copy per search node, restarts need the trail
+    else if (cpu && (N > 25 || m_branching.restarts > 0 || m_settings.get("trailSearch").valueBool().value()))
+        success = solveWithTrail(f, fResult);
+    else
+        success = solveStep(f, 0, fResult);
+
+    if (!success)
+    {
+        if (m_logLevel > 0)
+            std::cout << (m_budgetExceeded ? "Unsolved within budget" : "Could not solve") << std::endl;
+        return;
+    }
+
+    if (m_logLevel > 0)
+    {
+        std::cout << "Solved" << std::endl;
+        fResult.print(0);
+    }
+
+    if (m_activeImpl == ImplementationType::CPU)
+        m_hResultCPU.clear();
+    else
+        m_hResultGPU.clear();
+
+    for (size_t row = 0; row < N; ++row)
+    {
+        for (size_t col = 0; col < N; ++col)
+        {
+            if (m_activeImpl == ImplementationType::CPU)
+                m_hResultCPU.push_back(fResult.value(row, col));
+            else
+                m_hResultGPU.push_back(fResult.value(row, col));
+        }
+    }
+}
+
+template<typename Solver>
+void Sudoku::DoComputeSolver(Solver& solver)
+{
+    std::vector<int> grid = m_hArray;
+
+    size_t numGiven = std::ranges::count_if(grid, [](int value){ return value > 0; });
+    if (m_N == 9 && numGiven < 17)
+    {
+        if (m_logLevel > 0)
+            std::cout << "Skip grid with too few values (" << numGiven << ")" << std::endl;
+        return;
+    }
+
+    // the standalone searches have no budget, they always run to the end
+    bool success = solver.solve(grid.data());
+    localStats().searchNodes += solver.nodes();
+
+    if (!success)
+    {
+        if (m_logLevel > 0)
+            std::cout << "Could not solve" << std::endl;
+        return;
+    }
+
+    if (m_logLevel > 0)
+    {
+        std::cout << "Solved" << std::endl;
+        print(grid.data(), 0);
+    }
+
+    m_hResultCPU = grid;
+}
+
+template<size_t N>
+bool Sudoku::solveGrid(const int* grid, int* outGrid, bool trail)
+{
+    Field<N> f;
+    for (size_t i = 0; i < N * N; ++i)
+    {
+        if (grid[i] > 0 && !f.setValue(i / N, i % N, grid[i]))
+        {
+            return false;
+        }
+    }
+
+    return solveField(f, outGrid, trail);
+}
+
+template<size_t N>
+bool Sudoku::solveField(Field<N>& f, int* outGrid, bool trail)
+{
+    Field<N> fResult;
+    if (!(trail || N > 25 || m_branching.restarts > 0 ? solveWithTrail(f, fResult) : solveStep(f, 0, fResult)))
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < N * N; ++i)
+    {
+        outGrid[i] = fResult.value(i / N, i % N);
+    }
+
+    return true;
+}
+
+template<size_t N>
+size_t Sudoku::solveGPU(const int* grids, int* outGrids, size_t count, LatencyHistogram* latency)
+{
+    const size_t numCells = N * N;
+    const size_t batchSize = std::max(1, m_settings.get("gpuBatchSize").valueInt().value());
+
+    SolverStats& stats = localStats();
+    Timer timer;
+
+    if (m_settings.get("gpuSearch").valueBool().value())
+    {
+        // every grid is searched to the end in one launch, the batch only shrinks if the stacks would get too big
+        const size_t stackBytes = numCells * (numCells + 3) * sizeof(cl_int);
+        const size_t chunk = std::clamp(MaxSearchStackBytes / stackBytes, size_t(1), batchSize);
+
+        // grids of launches skipped by the budget stay unsolved
+        std::fill(outGrids, outGrids + count * numCells, 0);
+
+        std::vector<int> batch, flags;
+        size_t solved = 0;
+        // a launch can't be interrupted, the budget is checked between launches
+        for (size_t first = 0; first < count && !budgetExpired(); first += chunk)
+        {
+            const size_t n = std::min(chunk, count - first);
+            batch.assign(grids + first * numCells, grids + (first + n) * numCells);
+            launchGPU(batch, flags, n, true);
+
+            // all grids of a launch are done when it returns
+            for (size_t g = 0; latency && g < n; ++g)
+            {
+                latency->record(timer.elapsed());
+            }
+
+            for (size_t g = 0; g < n; ++g)
+            {
+                stats.searchNodes += flags[3 * g + 2];
+
+                if (flags[3 * g] == 0 && flags[3 * g + 1] == 0)
+                {
+                    std::copy(batch.begin() + g * numCells, batch.begin() + (g + 1) * numCells, outGrids + (first + g) * numCells);
+                    ++solved;
+                }
+            }
+
+            if (m_logLevel > 0)
+            {
+                std::cout << std::format("GPU search of {} grids, {} solved so far", n, solved) << std::endl;
+            }
+        }
+
+        return solved;
+    }
+
+    // open search nodes of all grids, the grid they belong to and their depth, taken from the back (depth first)
+    std::vector<int> pending(grids, grids + count * numCells);
+    std::vector<size_t> owner(count);
+    std::iota(owner.begin(), owner.end(), 0);
+    std::vector<size_t> depth(count, 0);
+    std::vector<bool> done(count, false);
+
+    std::fill(outGrids, outGrids + count * numCells, 0);
+    size_t solved = 0;
+
+    std::vector<int> batch, flags;
+    std::vector<size_t> batchOwner, batchDepth;
+    while (!owner.empty() && solved < count && !budgetExpired())
+    {
+        batch.clear();
+        batchOwner.clear();
+        batchDepth.clear();
+        while (!owner.empty() && batchOwner.size() < batchSize)
+        {
+            if (!done[owner.back()])
+            {
+                batch.insert(batch.end(), pending.end() - numCells, pending.end());
+                batchOwner.push_back(owner.back());
+                batchDepth.push_back(depth.back());
+            }
+            pending.resize(pending.size() - numCells);
+            owner.pop_back();
+            depth.pop_back();
+        }
+
+        if (batchOwner.empty())
+        {
+            break;
+        }
+
+        launchGPU(batch, flags, batchOwner.size(), false);
+
+        if (m_logLevel > 0)
+        {
+            std::cout << std::format("GPU batch of {} grids, {} still open", batchOwner.size(), owner.size()) << std::endl;
+        }
+
+        stats.propagationPasses += batchOwner.size();
+
+        for (size_t g = 0; g < batchOwner.size(); ++g)
+        {
+            const size_t grid = batchOwner[g];
+            stats.maxDepth = std::max(stats.maxDepth, batchDepth[g]);
+            if (done[grid]) // solved by another node
+            {
+                continue;
+            }
+
+            Field<N> node;
+            const int* values = batch.data() + g * numCells;
+            bool consistent = flags[3 * g + 1] == 0;
+            for (size_t i = 0; i < numCells && consistent; ++i)
+            {
+                if (values[i] > 0)
+                    consistent = node.setValue(i / N, i % N, values[i]);
+            }
+
+            if (!consistent)
+            {
+                if (batchDepth[g] > 0)
+                    ++stats.backtracks;
+                continue;
+            }
+
+            if (node.solved())
+            {
+                std::copy(values, values + numCells, outGrids + grid * numCells);
+                done[grid] = true;
+                ++solved;
+                if (latency)
+                    latency->record(timer.elapsed());
+                continue;
+            }
+
+            // branch on the cell with fewest candidates, the smallest value ends up on top
+            size_t row, col;
+            node.mostSolvedCell(row, col);
+            for (int p = N; p >= 1; --p)
+            {
+                if (node.possible(row, col, p))
+                {
+                    ++stats.searchNodes;
 
-bool Sudoku::ValidateResults()
-{
-    for (size_t i = 0; i < m_N * m_N; ++i)
+                    pending.insert(pending.end(), values, values + numCells);
+                    pending[pending.size() - numCells + row * N + col] = p;
+                    owner.push_back(grid);
+                    depth.push_back(batchDepth[g] + 1);
+                }
+            }
+        }
+    }
+
+    // grids without solution are done once their last node failed
+    for (size_t grid = 0; latency && grid < count; ++grid)
     {
-        if (m_hResultCPU[i] != m_hResultGPU[i])
-            return false;
+        if (!done[grid])
+            latency->record(timer.elapsed());
     }
 
-    return true;
+    return solved;
 }
 
-void Sudoku::DoCompute()
+void Sudoku::launchGPU(std::vector<int>& grids, std::vector<int>& flags, size_t count, bool search)
 {
-    Field f(m_N), fResult(m_N);
-    bool valid = false;
-    for (size_t row = 0; row < m_N; ++row)
-    {
-        for (size_t col = 0; col < m_N; ++col)
-        {
-            int val = m_hArray[row * m_N + col];
-            if (val > 0)
-            {
-                valid |= f.setValue(row, col, val);
-            }
-        }
-    }
+    const size_t numCells = m_N * m_N;
+    // the candidates of a cell have to fit into one uint
+    const bool masks = m_N <= 32 && m_settings.get("gpuBitmask").valueBool().value();
+    cl_kernel kernel = masks ? (search ? m_MaskSearchKernel : m_MaskBatchKernel) : (search ? m_SearchKernel : m_BatchKernel);
 
-    if (!valid)
+    if (count > m_batchCapacity)
     {
-        std::cout << "Invalid input" << std::endl;
-        f.print(0);
-        return;
+        if (m_dBatchArray) clReleaseMemObject(m_dBatchArray);
+        if (m_dBatchFlags) clReleaseMemObject(m_dBatchFlags);
+
+        cl_int clError, clError2;
+        m_dBatchArray = clCreateBuffer(m_Context, CL_MEM_READ_WRITE, sizeof(cl_int) * numCells * count, nullptr, &clError2);
+        clError = clError2;
+        m_dBatchFlags = clCreateBuffer(m_Context, CL_MEM_READ_WRITE, sizeof(cl_int) * 3 * count, nullptr, &clError2);
+        clError |= clError2;
+        CLUtil::handleCLErrors(clError, "Error allocating device arrays");
+
+        m_batchCapacity = count;
     }
 
-    if (f.numSolvedCells() < 17)
+    if (search && count > m_stackCapacity)
     {
-        std::cout << "Skip grid with too few values (" << f.numSolvedCells() << ")" << std::endl;
-        return;
+        if (m_dSearchStacks) clReleaseMemObject(m_dSearchStacks);
+
+        cl_int clError;
+        m_dSearchStacks = clCreateBuffer(m_Context, CL_MEM_READ_WRITE, sizeof(cl_int) * numCells * (numCells + 3) * count, nullptr, &clError);
+        CLUtil::handleCLErrors(clError, "Error allocating device arrays");
+
+        m_stackCapacity = count;
     }
 
-    if (m_logLevel > 0)
-        f.print(0);
+    flags.resize(3 * count);
+
+    // one upload, one launch and one readback for the whole batch
+    CLUtil::handleCLErrors(clEnqueueWriteBuffer(m_CommandQueue, m_dBatchArray, CL_FALSE, 0, count * numCells * sizeof(cl_int), grids.data(), 0, NULL, NULL), "Error copying data from host to device!");
 
-    if (!solveStep(f, 0, fResult))
+    cl_int clErr;
+    clErr = clSetKernelArg(kernel, 0, sizeof(cl_mem), static_cast<void*>(&m_dBatchArray));
+    clErr |= clSetKernelArg(kernel, 1, sizeof(cl_mem), static_cast<void*>(&m_dBatchFlags));
+    clErr |= clSetKernelArg(kernel, 2, masks ? sizeof(cl_int) * 9 * m_N : sizeof(cl_int) * 4, NULL);
+    clErr |= clSetKernelArg(kernel, 3, sizeof(cl_int) * numCells, NULL);
+    clErr |= clSetKernelArg(kernel, 4, masks ? sizeof(cl_uint) * numCells : sizeof(cl_char) * numCells * m_possArrayCellSize, NULL);
+    clErr |= clSetKernelArg(kernel, 5, sizeof(cl_uint), static_cast<void*>(&m_N));
+    clErr |= clSetKernelArg(kernel, 6, sizeof(cl_uint), static_cast<void*>(&m_possArrayCellSize));
+    if (search)
     {
-        std::cout << "Could not solve" << std::endl;
-        return;
+        clErr |= clSetKernelArg(kernel, 7, sizeof(cl_mem), static_cast<void*>(&m_dSearchStacks));
+        clErr |= clSetKernelArg(kernel, 8, sizeof(cl_int) * 3, NULL);
     }
-    else
+    CLUtil::handleCLErrors(clErr, search ? "Error setting kernel args for SearchKernel" : "Error setting kernel args for BatchKernel");
+
+    size_t globalWorkSize[2] = {m_N * count, m_N};
+    size_t localWorkSize[2] = {m_N, m_N};
+    clErr = clEnqueueNDRangeKernel(m_CommandQueue, kernel, 2, nullptr, globalWorkSize, localWorkSize, 0, nullptr, nullptr);
+    CLUtil::handleCLErrors(clErr, search ? "Error executing SearchKernel!" : "Error executing BatchKernel!");
+
+    CLUtil::handleCLErrors(clEnqueueReadBuffer(m_CommandQueue, m_dBatchArray, CL_FALSE, 0, count * numCells * sizeof(cl_int), grids.data(), 0, NULL, NULL), "Error reading data from device!");
+    CLUtil::handleCLErrors(clEnqueueReadBuffer(m_CommandQueue, m_dBatchFlags, CL_TRUE, 0, 3 * count * sizeof(cl_int), flags.data(), 0, NULL, NULL), "Error reading data from device!");
+}
+
+size_t Sudoku::solveLockstep(const int* grids, int* outGrids, size_t count, bool trail)
+{
+    constexpr size_t N = 9;
+    constexpr size_t B = SudokuSimd::BatchSize;
+    assert(count <= B);
+
+    Timer timer;
+    SolverStats& stats = localStats();
+
+    // unused lanes stay empty and are reported as invalid
+    std::array<uint16_t, N * N * B> candidates{};
+    std::array<size_t, B> given{};
+    for (size_t g = 0; g < count; ++g)
     {
-        std::cout << "Solved" << std::endl;
+        for (size_t cell = 0; cell < N * N; ++cell)
+        {
+            int value = grids[g * N * N + cell];
+            candidates[B * cell + g] = value <= 0 ? Cell<N>::AllPossible : value <= int(N) ? Cell<N>::bit(value) : 0;
+            given[g] += value > 0;
+        }
     }
 
-    if (m_logLevel > 0)
-        fResult.print(0);
-
-    if (m_activeImpl == ImplementationType::CPU)
-        m_hResultCPU.clear();
-    else
-        m_hResultGPU.clear();
+    uint32_t invalid = SudokuSimd::propagateBatch9(candidates.data());
+    stats.propagationPasses += count;
 
-    for (size_t row = 0; row < m_N; ++row)
+    size_t solved = 0;
+    std::array<uint16_t, N * N> masks;
+    for (size_t g = 0; g < count; ++g)
     {
-        for (size_t col = 0; col < m_N; ++col)
+        int* outGrid = outGrids + g * N * N;
+        bool success = false;
+        if (!(invalid & (1u << g)))
         {
-            if (m_activeImpl == ImplementationType::CPU)
-                m_hResultCPU.push_back(fResult.value(row, col));
+            bool complete = true;
+            size_t singles = 0;
+            for (size_t cell = 0; cell < N * N; ++cell)
+            {
+                masks[cell] = candidates[B * cell + g];
+                complete &= std::popcount(masks[cell]) == 1;
+                singles += std::popcount(masks[cell]) == 1;
+            }
+            stats.ruleChanges[size_t(Rule::VectorSingle)] += singles - given[g];
+
+            if (complete)
+            {
+                for (size_t cell = 0; cell < N * N; ++cell)
+                {
+                    outGrid[cell] = std::countr_zero(masks[cell]) + 1;
+                }
+                success = true;
+            }
             else
-                m_hResultGPU.push_back(fResult.value(row, col));
+            {
+                // branching is left to the search of a single grid
+                Field<N> f;
+                f.restrictCandidates(masks.data());
+                success = solveField(f, outGrid, trail);
+            }
         }
+
+        if (success)
+            ++solved;
+        else
+            std::fill(outGrid, outGrid + N * N, 0);
+
+        // the grids of a group are done one after the other once the common propagation finished
+        stats.latency.record(timer.elapsed());
     }
+
+    return solved;
 }
 
-bool Sudoku::solveStep(Field& f, int recursionDepth, Field& outResult)
+template<size_t N>
+bool Sudoku::solveStep(Field<N>& f, int recursionDepth, Field<N>& outResult)
 {
     if (m_activeImpl == ImplementationType::CPU)
     {
-        bool valid = true;
-        int singleStepSolved, acc = 0, steps = 0;
-        do
-        {
-            std::tie(valid, singleStepSolved) = f.solveStep();
-            acc += singleStepSolved;
-            ++steps;
-        } while (valid && singleStepSolved > 0);
-
-        if (m_logLevel > recursionDepth)
-        {
-            printIndent(recursionDepth);
-            std::cout << steps << " forced step(s) solved " << acc << " cells" << std::endl;
-            f.print(recursionDepth);
-        }
+        bool valid = propagate(f, recursionDepth);
 
         if (f.solved())
         {
@@ -337,6 +1492,9 @@ bool Sudoku::solveStep(Field& f, int recursionDepth, Field& outResult)
         if (!valid)
             return false;
 
+        if (recursionDepth == 0)
+            branchState.conflicts.clear();
+
         size_t row, col; int val;
         bool success;
         success = solveTrial(f, row, col, val, recursionDepth + 1, outResult);
@@ -346,11 +1504,11 @@ bool Sudoku::solveStep(Field& f, int recursionDepth, Field& outResult)
     else if (m_activeImpl == ImplementationType::GPU)
     {
         // Write Field f to array
-        for (size_t row = 0; row < m_N; ++row)
+        for (size_t row = 0; row < N; ++row)
         {
-            for (size_t col = 0; col < m_N; ++col)
+            for (size_t col = 0; col < N; ++col)
             {
-                m_hArray[row * m_N + col] = f.value(row, col);
+                m_hArray[row * N + col] = f.value(row, col);
             }
         }
 
@@ -397,11 +1555,11 @@ bool Sudoku::solveStep(Field& f, int recursionDepth, Field& outResult)
         //}
 
         // Write to F
-        for (size_t row = 0; row < m_N; ++row)
+        for (size_t row = 0; row < N; ++row)
         {
-            for (size_t col = 0; col < m_N; ++col)
+            for (size_t col = 0; col < N; ++col)
             {
-                int value = m_hResultGPU[row * m_N + col];
+                int value = m_hResultGPU[row * N + col];
                 if (value > 0)
                 {
                     f.setValue(row, col, value);
@@ -409,10 +1567,9 @@ bool Sudoku::solveStep(Field& f, int recursionDepth, Field& outResult)
             }
         }
 
-        if (m_logLevel > recursionDepth)
+        if (SudokuTrace::enabled(m_logLevel, recursionDepth))
         {
-            printIndent(recursionDepth);
-            std::cout << "single step solve: " << m_hResultGPUFlags[2] << std::endl;
+            SudokuTrace::line(recursionDepth, "single step solve: {}", m_hResultGPUFlags[2]);
             print(m_hResultGPU.data(), recursionDepth);
         }
 
@@ -437,442 +1594,389 @@ bool Sudoku::solveStep(Field& f, int recursionDepth, Field& outResult)
     }
 }
 
-bool Sudoku::solveTrial(Field &f, size_t &outRow, size_t &outCol, int &outValue, int recursionDepth, Field& outResult)
+template<size_t N>
+bool Sudoku::propagate(Field<N>& f, int recursionDepth)
 {
-    f.mostSolvedCell(outRow, outCol);
+    bool valid = true;
+    int singleStepSolved, acc = 0, steps = 0;
 
-    for (size_t p = 1; p <= m_N; ++p)
+    SolverStats& stats = localStats();
+    stats.maxDepth = std::max(stats.maxDepth, size_t(recursionDepth));
+
+    if constexpr (N == 9)
     {
-        if (f.possible(outRow, outCol, p))
+        if (m_simd)
         {
-            outValue = p;
-
-            if (m_logLevel >= recursionDepth)
+            // singles are done vectorized, the steps below only find the higher order deductions
+            std::array<uint16_t, N * N> masks;
+            f.candidateMasks(masks.data());
+            valid = SudokuSimd::propagate9(masks.data());
+            if (valid)
             {
-                printIndent(recursionDepth);
-                std::cout << std::format("trial solve: ({}|{}) = {}", outCol, outRow, outValue) << std::endl;
+                size_t solvedBefore = f.numSolvedCells();
+                acc = f.restrictCandidates(masks.data());
+                stats.ruleChanges[size_t(Rule::VectorSingle)] += f.numSolvedCells() - solvedBefore;
             }
+            ++steps;
 
-            Field f2 = f;
-            f2.setValue(outRow, outCol, outValue);
+            // the queued cells and units of the scalar step are already at their fixpoint
+            if (m_deductions == 0)
+                f.clearPending();
+        }
+    }
 
-            if (m_logLevel > recursionDepth)
-            {
-                f2.print(recursionDepth);
-            }
+    while (valid)
+    {
+        std::tie(valid, singleStepSolved) = f.solveStep(m_deductions, &stats.ruleChanges);
+        acc += singleStepSolved;
+        ++steps;
 
-            if (solveStep(f2, recursionDepth, outResult))
-            {
-                return true;
-            }
-        }
+        if (singleStepSolved == 0)
+            break;
     }
+    stats.propagationPasses += steps;
 
-    if (m_logLevel >= recursionDepth)
+    if (SudokuTrace::enabled(m_logLevel, recursionDepth))
     {
-        printIndent(recursionDepth);
-        std::cout << std::format("Trial solve for ({}|{}) failed", outCol, outRow) << std::endl;
+        SudokuTrace::line(recursionDepth, "{} forced step(s) made {} changes", steps, acc);
+        f.print(recursionDepth);
     }
-    return false;
+
+    return valid;
 }
 
-bool Sudoku::solveTrialSplit(Field &f, size_t &outRow, size_t &outCol, int &outValue, int recursionDepth, Field& outResult)
+template<size_t N>
+bool Sudoku::solveParallel(Field<N>& f, Field<N>& outResult)
 {
-    for (size_t i = 0; i < m_N * m_N; i++)
+    ThreadPool& pool = threadPool();
+    ThreadPool::TaskGroup group(pool);
+    std::mutex resultMutex;
+
+    LogMute mute(m_logLevel);
+    m_solved = false;
+
+    // Branches are queued as tasks up to splitDepth, enough to keep every worker busy,
+    // deeper subtrees are searched sequentially by the worker that picked them up.
+    const int splitDepth = static_cast<int>(std::ceil(std::log2(double(pool.size()) * 16.0)));
+    // the subtrees of fields above 25x25 are too large to copy per search node, restarts need the trail
+    const bool trail = N > 25 || m_branching.restarts > 0 || m_settings.get("trailSearch").valueBool().value();
+
+    std::function<void(Field<N>&, int)> branch = [&](Field<N>& field, int depth)
     {
-        size_t row = i / m_N;
-        size_t col = i % m_N;
-        if (f.value(row, col) == 0)
+        if (m_solved || m_budgetExceeded)
+            return;
+
+        bool valid = propagate(field, depth);
+        if (!valid)
         {
-            std::vector<Field> solves(m_N, Field(m_N));
-            std::vector<std::thread> runners;
-            for (size_t p = 1; p <= m_N; ++p)
+            if (depth > 0)
+                ++localStats().backtracks;
+            return;
+        }
+
+        Field<N> result;
+        bool found = false;
+        if (field.solved())
+        {
+            result = field;
+            found = true;
+        }
+        else if (depth >= splitDepth)
+        {
+            size_t row, col; int val;
+            found = trail ? solveWithTrail(field, result) : solveTrial(field, row, col, val, depth + 1, result);
+        }
+        else
+        {
+            size_t row, col;
+            field.mostSolvedCell(row, col);
+            for (size_t p = 1; p <= N; ++p)
             {
-                if (f.possible(row, col, p) == true)
+                if (field.possible(row, col, p))
                 {
-                    if (m_logLevel >= recursionDepth)
-                    {
-                        for (int tab = 0; tab < recursionDepth - 1; tab++)
-                        {
-                            std::cout << " | ";
-                        }
-
-                        std::cout << "trial solve: (" << col << "|" << row << ") = " << p << std::endl;
-                    }
-
-                    runners.push_back(std::thread([=, this, &solves]{
-                        Field f2 = f;
-                        f2.setValue(row, col, p);
-
-                        if (solveStep(f2, recursionDepth, solves[p-1]))
-                        {
-                            m_solved = true;
-                        }
-                    }));
-                }
-            }
+                    if (exhausted())
+                        break;
+                    ++localStats().searchNodes;
 
-            for (auto& r : runners)
-            {
-                r.join();
+                    Field<N> f2 = field;
+                    f2.setValue(row, col, p);
+                    group.run([&branch, f2, depth]() mutable { branch(f2, depth + 1); });
+                }
             }
+        }
 
-            m_solved = false;
-
-            outValue = 1;
-            for (auto& s : solves)
+        if (found)
+        {
+            std::lock_guard<std::mutex> lock(resultMutex);
+            if (!m_solved)
             {
-                if (s.solved())
-                {
-                    outRow = row;
-                    outCol = col;
-                    outResult = s;
-                    return true;
-                }
-                ++outValue;
+                outResult = result;
+                m_solved = true;
+                group.cancel();
             }
-
-            return false;
         }
-    }
-
-    assert(false);
-    return f.solved();
-}
+    };
 
-Cell::Cell(size_t N) : m_N(N)
-{
-    m_value = 0;
-    m_possible = std::vector<bool>(m_N, true);
-}
+    Field<N> root = f;
+    branch(root, 0);
+    group.wait();
 
-void Cell::disable(int value)
-{
-    m_possible[value - 1] = false;
+    bool success = m_solved;
+    m_solved = false;
+    return success;
 }
 
-bool Cell::possible(int value) const
+template<size_t N>
+bool Sudoku::solveWithTrail(Field<N>& f, Field<N>& outResult)
 {
-    assert(value > 0 && value <= m_N);
-
-    if (!valid())
+    // one trail per thread, it keeps its capacity so the search does not allocate per node
+    static thread_local typename Field<N>::Trail trail;
+    trail.clear();
+    branchState.conflicts.clear();
+    branchState.nodesLeft = m_branching.restarts > 0 ? m_branching.restartNodes : SIZE_MAX;
+
+    f.setTrail(&trail);
+    bool success = solveTrialTrail(f, 0);
+
+    // a cut run is rolled back to the propagated givens, the search starts over from there with other
+    // tie-breaks and twice the node limit. The conflict counts of the previous runs are kept.
+    size_t limit = m_branching.restartNodes;
+    for (size_t run = 1; !success && branchState.cut; ++run)
     {
-        return false;
+        ++localStats().restarts;
+        limit *= 2;
+        branchState.seed = uint32_t(run * 0x9E3779B9u);
+        branchState.nodesLeft = run < m_branching.restarts ? limit : SIZE_MAX;
+        branchState.cut = false;
+
+        trail.clear();
+        success = solveTrialTrail(f, 0);
     }
+    f.setTrail(nullptr);
 
-    return m_possible[value - 1];
-}
-
-size_t Cell::possibilities() const
-{
-    return std::count(m_possible.begin(), m_possible.end(), true);
-}
+    branchState.seed = 0;
+    branchState.nodesLeft = SIZE_MAX;
+    branchState.cut = false;
 
-bool Cell::setValue(int value)
-{
-    if (!m_possible[value - 1])
+    if (success)
     {
-        return false;
+        outResult = f;
     }
-
-    for (size_t i = 0; i < m_N; i++)
-        m_possible[i] = false;
-    m_value = value;
-    return true;
-}
-
-int Cell::value() const
-{
-    return m_value;
+    return success;
 }
 
-bool Cell::solve()
+template<size_t N>
+bool Sudoku::solveTrialTrail(Field<N>& f, int recursionDepth)
 {
-    int maybeSolution = -1;
-    bool invalid = true;
-    for (size_t i = 0; i < m_N; i++)
-    {
-        if (m_possible[i] == true)
-        {
-            invalid = false;
-
-            if (maybeSolution == -1)
-            {
-                maybeSolution = i;
-            }
-            else
-            {
-                maybeSolution = -1;
-                break;
-            }
-        }
-    }
-
-    if (invalid)
-    {
-        // no possible solutions left
-        m_value = -1;
-        return true;
-    }
-    else if (maybeSolution == -1)
+    if (!propagate(f, recursionDepth))
     {
-        // undecided
-        m_value = 0;
         return false;
     }
-    else
+
+    if (f.solved())
     {
-        // only value possible
-        m_value = maybeSolution + 1;
         return true;
     }
-}
 
-Field::Field(size_t N) : m_N(N), m_rows(m_N), m_cols(m_N), m_blocks(m_N)
-{
-    for (size_t i = 0; i < m_N * m_N; ++i)
+    size_t row, col;
+    branchCell(f, row, col);
+
+    std::array<int, N> values;
+    size_t count = f.branchValues(row, col, m_branching.leastConstraining, values);
+
+    // the value of the previous solution is tried first (see resolve())
+    int hint = m_valueHint ? m_valueHint[N * row + col] : 0;
+    auto first = std::find(values.begin(), values.begin() + count, hint);
+    if (first != values.begin() + count)
     {
-        m_cells.emplace_back(m_N);
+        std::rotate(values.begin(), first, first + 1);
     }
 
-    for (size_t i = 0; i < m_N; ++i)
+    for (size_t i = 0; i < count; ++i)
     {
-        for (size_t j = 0; j < m_N; ++j)
+        int p = values[i];
+
+        // another branch of a parallel search was successful or the restart limit is reached
+        if (m_solved || branchState.cut)
         {
-            m_rows[i].push_back(m_N * i + j);
-            m_cols[i].push_back(m_N * j + i);
+            return false;
         }
-    }
 
-    size_t r = sqrt(m_N);
-    for (size_t block = 0; block < m_N; ++block)
-    {
-        size_t brow = block / r;
-        size_t bcol = block % r;
-        for (size_t row = r * brow; row < r * (brow + 1); ++row)
+        if (SudokuTrace::enabled(m_logLevel, recursionDepth))
         {
-            for (size_t col = r * bcol; col < r * (bcol + 1); ++col)
-            {
-                m_blocks[block].push_back(m_N * row + col);
-            }
+            SudokuTrace::line(recursionDepth + 1, "trial solve: ({}|{}) = {}", col, row, p);
         }
-    }
-}
-
-bool Field::setValue(size_t row, size_t col, int value)
-{
-    assert(row >= 0 && row < m_N && col >= 0 && col < m_N);
-    bool valid = m_cells[m_N * row + col].setValue(value);
-    if (!valid)
-    {
-        return false;
-    }
 
-    for (size_t i = 0; i < m_N; i++)
-        m_cells[m_N * row + i].disable(value);
+        if (exhausted())
+        {
+            return false;
+        }
+        if (branchState.nodesLeft == 0)
+        {
+            branchState.cut = true;
+            return false;
+        }
+        --branchState.nodesLeft;
+        ++localStats().searchNodes;
 
-    for (size_t i = 0; i < m_N; i++)
-        m_cells[m_N * i + col].disable(value);
+        size_t checkpoint = f.checkpoint();
+        f.setValue(row, col, p);
 
-    size_t r = sqrt(m_N);
-    for (size_t i = r * (row / r); i < (r * (row / r) + r); i++)
-    {
-        for (size_t j = r * (col / r); j < (r * (col / r) + r); j++)
+        if (solveTrialTrail(f, recursionDepth + 1))
         {
-            m_cells[m_N * i + j].disable(value);
+            return true;
         }
+
+        ++localStats().backtracks;
+        addConflict<N>(row, col);
+        f.rollback(checkpoint);
     }
 
-    return true;
+    if (SudokuTrace::enabled(m_logLevel, recursionDepth))
+    {
+        SudokuTrace::line(recursionDepth + 1, "Trial solve for ({}|{}) failed", col, row);
+    }
+    return false;
 }
 
-Cell& Field::cell(size_t row, size_t col) const
+template<size_t N>
+size_t Sudoku::countField(Field<N>& f, size_t cap, int* outSolution)
 {
-    assert(row >= 0 && row < m_N && col >= 0 && col < m_N);
-
-    return const_cast<Cell&>(m_cells[m_N * row + col]);
-}
+    static thread_local typename Field<N>::Trail trail;
+    trail.clear();
+    branchState.conflicts.clear();
 
-int Field::value(size_t row, size_t col) const
-{
-    return cell(row, col).value();
-}
+    f.setTrail(&trail);
+    size_t count = countTrail(f, cap, 0, outSolution);
+    f.setTrail(nullptr);
 
-bool Field::possible(size_t row, size_t col, int value) const
-{
-    return cell(row, col).possible(value);
+    return count;
 }
 
-std::tuple<bool, int> Field::solveStep()
+template<size_t N>
+size_t Sudoku::countTrail(Field<N>& f, size_t cap, int recursionDepth, int*& outSolution)
 {
-    int changes = 0;
-    for (size_t i = 0; i < m_N * m_N; i++)
+    if (!propagate(f, recursionDepth))
     {
-        Cell& cell = m_cells[i];
-        if (cell.solved())
-            continue;
+        return 0;
+    }
 
-        if (cell.solve())
+    if (f.solved())
+    {
+        if (outSolution)
         {
-            ++changes;
-            if (!cell.valid())
+            for (size_t i = 0; i < N * N; ++i)
             {
-                return {false, changes};
+                outSolution[i] = f.value(i / N, i % N);
             }
-
-            setValue(i / m_N, i % m_N, cell.value());
+            outSolution = nullptr;
         }
+        return 1;
     }
 
-    auto solveBlock = [&](int value, auto&& block)
+    size_t row, col;
+    branchCell(f, row, col);
+    std::array<int, N> values;
+    f.branchValues(row, col, m_branching.leastConstraining, values);
+    const int value = values[0];
+
+    if (SudokuTrace::enabled(m_logLevel, recursionDepth))
     {
-        size_t numCellsWherePossible = 0;
-        int indexPossible = 0;
-        for (const auto& i : block)
-        {
-            Cell& c = m_cells[i];
-            if (!c.solved() && c.possible(value))
-            {
-                ++numCellsWherePossible;
-                indexPossible = i;
-            }
-        }
-        if (numCellsWherePossible == 1)
-        {
-            setValue(indexPossible / m_N, indexPossible % m_N, value);
-            ++changes;
-        }
-    };
+        SudokuTrace::line(recursionDepth + 1, "count solutions: ({}|{}) = {}", col, row, value);
+    }
 
-    for (const auto& row : m_rows)
+    if (exhausted())
     {
-        for (size_t value = 1; value <= m_N; ++value)
-        {
-            solveBlock(value, row);
-        }
+        return 0;
     }
-    for (const auto& col : m_cols)
+    ++localStats().searchNodes;
+
+    size_t checkpoint = f.checkpoint();
+    f.setValue(row, col, value);
+    size_t count = countTrail(f, cap, recursionDepth + 1, outSolution);
+    f.rollback(checkpoint);
+
+    if (count == 0)
     {
-        for (size_t value = 1; value <= m_N; ++value)
-        {
-            solveBlock(value, col);
-        }
+        ++localStats().backtracks;
+        addConflict<N>(row, col);
     }
-    for (const auto& block : m_blocks)
+    if (count >= cap)
     {
-        for (size_t value = 1; value <= m_N; ++value)
-        {
-            solveBlock(value, block);
-        }
+        return count;
     }
 
-    return {true, changes};
+    // all solutions with this value are counted, the other values are searched with it excluded,
+    // so whatever the exclusion propagates is shared by all of them instead of being redone per value
+    f.exclude(row, col, value);
+    return count + countTrail(f, cap - count, recursionDepth, outSolution);
 }
 
-bool Field::solved() const
+template<size_t N>
+bool Sudoku::solveTrial(Field<N> &f, size_t &outRow, size_t &outCol, int &outValue, int recursionDepth, Field<N>& outResult)
 {
-    return std::ranges::all_of(m_cells, [](const Cell& cell){ return cell.solved(); });
-}
+    branchCell(f, outRow, outCol);
 
-bool Field::valid() const
-{
-    return std::ranges::all_of(m_cells, [](const Cell& cell) { return cell.valid(); });
-}
+    std::array<int, N> values;
+    size_t count = f.branchValues(outRow, outCol, m_branching.leastConstraining, values);
 
-size_t Field::numSolvedCells() const
-{
-    return std::accumulate(m_cells.begin(), m_cells.end(),
-                           0, [](size_t filled, const Cell& cell){ return filled + (cell.solved() ? 1 : 0); });
-}
+    for (size_t i = 0; i < count; ++i)
+    {
+        int p = values[i];
 
-size_t Field::valueCount(int value) const
-{
-    return std::accumulate(m_cells.begin(), m_cells.end(),
-                           0, [value](size_t count, const Cell& cell){ return count + (cell.value() == value ? 1 : 0); });
-}
+        // another branch of a parallel search was successful
+        if (m_solved)
+        {
+            return false;
+        }
 
-size_t Field::mostlySolvedNumber() const
-{
-    std::map<size_t, int, std::greater<size_t>> solveCountPerValueDesc;
-    for (size_t p = 1; p <= m_N; ++p)
-    {
-        size_t count = valueCount(p);
-        if (count < m_N)
+        if (exhausted())
         {
-            solveCountPerValueDesc[count] = p;
+            return false;
         }
-    }
 
-    return solveCountPerValueDesc.empty() ? 0 : solveCountPerValueDesc.begin()->second;
-}
+        outValue = p;
+        ++localStats().searchNodes;
 
-size_t Field::mostSolvedCell(size_t& outRow, size_t& outCol) const
-{
-    size_t minIndex = 0, value = m_N;
-    for (size_t i = 0; i < m_cells.size(); ++i)
-    {
-        auto p = m_cells[i].possibilities();
-        if (p > 0 && p < value)
+        // the trial lines belong to the level of the calling solveStep()
+        if (SudokuTrace::enabled(m_logLevel, recursionDepth - 1))
         {
-            value = p;
-            minIndex = i;
+            SudokuTrace::line(recursionDepth, "trial solve: ({}|{}) = {}", outCol, outRow, outValue);
         }
-    }
-
-    outRow = minIndex / m_N;
-    outCol = minIndex % m_N;
-    return value;
-}
 
-void printIndent(int recursionDepth)
-{
-    for (int tab = 0; tab < recursionDepth; tab++)
-    {
-        std::cout << " | ";
-    }
-}
+        Field<N> f2 = f;
+        f2.setValue(outRow, outCol, outValue);
 
-template<typename F>
-void print(int N, F &field, int recursionDepth)
-{
-    size_t r = sqrt(N);
-    for (size_t i = 0; i < N + r + 1; i++)
-    {
-        printIndent(recursionDepth);
-        for (size_t j = 0; j < N + r + 1; j++)
+        if (SudokuTrace::enabled(m_logLevel, recursionDepth))
         {
-            if (i % (r + 1) == 0)
-                std::cout << "--";
-            else
-            {
-                if (j % (r + 1) == 0)
-                    std::cout << "|";
-                else
-                {
-                    size_t row = i - (i / (r + 1) + 1);
-                    size_t col = j - (j / (r + 1) + 1);
-
-                    int value = field[N * row + col];
-                    if (value == 0)
-                        std::cout << " ";
-                    else
-                        std::cout << value;
-                }
+            f2.print(recursionDepth);
+        }
 
-                std::cout << " ";
-            }
+        if (solveStep(f2, recursionDepth, outResult))
+        {
+            return true;
         }
 
-        std::cout << std::endl;
+        ++localStats().backtracks;
+        addConflict<N>(outRow, outCol);
+    }
+
+    if (SudokuTrace::enabled(m_logLevel, recursionDepth - 1))
+    {
+        SudokuTrace::line(recursionDepth, "Trial solve for ({}|{}) failed", outCol, outRow);
     }
+    return false;
 }
 
-void Field::print(int recursionDepth) const
+void printIndent(int recursionDepth)
 {
-    ::print(m_N, m_cells, recursionDepth);
+    for (int tab = 0; tab < recursionDepth; tab++)
+    {
+        std::cout << " | ";
+    }
 }
 
 void Sudoku::print(int *field, int recursionDepth)
 {
-    ::print(m_N, field, recursionDepth);
+    printField(m_N, field, recursionDepth);
 }
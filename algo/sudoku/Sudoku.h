@@ -1,9 +1,17 @@
 #pragma once
 
 #include "../Algorithm.h"
-class Field;
+#include "SolverStats.h"
+template<size_t N> class Field;
+class DancingLinks;
+class Bitboard9;
+class SolutionCache;
+class ThreadPool;
 
 #include <atomic>
+#include <chrono>
+#include <memory>
+#include <stop_token>
 
 class Sudoku : public Algorithm
 {
@@ -11,14 +19,117 @@ public:
     Sudoku(size_t N);
     ~Sudoku() override;
 
+    /**
+     * @brief Alternative digit the OCR found in a cell and its match score
+     */
+    struct Alternative
+    {
+        int value;
+        double score;
+    };
+    using Alternatives = std::vector<Alternative>;
+
 private:
-    bool solveTrial(Field &f, size_t &outRow, size_t &outCol, int &outValue, int recursionDepth, Field& outResult);
-    bool solveTrialSplit(Field &f, size_t &outRow, size_t &outCol, int &outValue, int recursionDepth, Field& outResult);
-    bool solveStep(Field& f, int recursionDepth, Field& outResult);
+    template<size_t N>
+    bool solveTrial(Field<N> &f, size_t &outRow, size_t &outCol, int &outValue, int recursionDepth, Field<N>& outResult);
+    template<size_t N>
+    bool solveStep(Field<N>& f, int recursionDepth, Field<N>& outResult);
+    template<size_t N>
+    bool propagate(Field<N>& f, int recursionDepth);
+    template<size_t N>
+    bool solveParallel(Field<N>& f, Field<N>& outResult);
+    template<size_t N>
+    bool solveWithTrail(Field<N>& f, Field<N>& outResult);
+    template<size_t N>
+    bool solveTrialTrail(Field<N>& f, int recursionDepth);
+    template<size_t N>
+    size_t countField(Field<N>& f, size_t cap, int* outSolution);
+    template<size_t N>
+    size_t countTrail(Field<N>& f, size_t cap, int recursionDepth, int*& outSolution);
+    template<size_t N>
+    bool solveTolerant(const int* grid, const std::vector<Alternatives>& alternatives, size_t maxFlips, double ratio,
+                       size_t& outFlips, int* outSolution, int* outGrid);
+    template<size_t N>
+    bool assignUncertain(Field<N>& f, const std::vector<std::pair<size_t, std::vector<int>>>& uncertain, size_t next, size_t flips);
+    template<size_t N>
+    bool resolveField(const int* grid, bool reuse, const int* hint, int* outSolution);
+    template<size_t N>
+    bool solveGrid(const int* grid, int* outGrid, bool trail);
+    template<size_t N>
+    bool solveField(Field<N>& f, int* outGrid, bool trail);
+    template<size_t N>
+    size_t solveGPU(const int* grids, int* outGrids, size_t count, LatencyHistogram* latency = nullptr);
+    void launchGPU(std::vector<int>& grids, std::vector<int>& flags, size_t count, bool search);
+    size_t solveLockstep(const int* grids, int* outGrids, size_t count, bool trail);
 
     void print(int* field, int recursionDepth);
 
     void DoCompute();
+    template<size_t N>
+    void DoCompute();
+    /**
+     * @brief DoComputeSolver solve m_hArray with a standalone solver (DancingLinks or Bitboard9)
+     */
+    template<typename Solver>
+    void DoComputeSolver(Solver& solver);
+
+    bool execBatch();
+
+    ThreadPool& threadPool();
+
+    /**
+     * @return counters of the calling thread, one instance per worker and one for all other threads
+     */
+    SolverStats& localStats();
+    void resetStats();
+    void collectStats();
+
+    unsigned deductionsFromSettings();
+
+    /**
+     * @brief Branching how the CPU searches pick the cell and order the values of a search node
+     */
+    struct Branching
+    {
+        // BranchCell tie-break
+        unsigned cell = 0;
+        bool leastConstraining = false;
+        // restarts of the trail search and the node limit of the first run, doubled per restart
+        size_t restarts = 0;
+        size_t restartNodes = 0;
+    };
+    Branching branchingFromSettings();
+
+    /**
+     * @brief branchCell cell to branch on in \a f by m_branching, see Field::branchCell()
+     */
+    template<size_t N>
+    void branchCell(const Field<N>& f, size_t& outRow, size_t& outCol);
+    /**
+     * @brief addConflict count a failed branch on cell (\a col, \a row) for the MOST_CONFLICTS tie-break
+     */
+    template<size_t N>
+    void addConflict(size_t row, size_t col);
+
+    /**
+     * @brief alternativesFromMat read the out_alternatives of TemplateMatch (N*N rows of (digit, score) pairs)
+     * @return empty if \a mat has another layout
+     */
+    std::vector<Alternatives> alternativesFromMat(const cv::Mat& mat) const;
+
+    /**
+     * @brief startBudget arm the "timeBudget" and "nodeBudget" settings and the stop token for one solve
+     */
+    void startBudget();
+    /**
+     * @brief exhausted count one search node
+     * @return true once the node or time budget is used up or a stop was requested, the search gives up then
+     */
+    bool exhausted();
+    /**
+     * @brief budgetExpired check the clock and the stop token without counting a node
+     */
+    bool budgetExpired();
 
 public: // IComputeTask
     bool InitResources(cl_device_id Device, cl_context Context, cl_command_queue CommandQueue) override;
@@ -31,8 +142,112 @@ public:
     bool exec() override;
 
 public:
+    /**
+     * @brief setLogLevel 0 is silent, 1 prints each grid and the run summary,
+     * higher levels print the search tree up to that depth (capped by SUDOKU_TRACE_LEVEL)
+     */
     void setLogLevel(int level);
 
+    /**
+     * @brief setStopToken exec(), resolve() and countSolutions() give up as soon as a stop is requested
+     *        on \a token, e.g. because a newer frame arrived. solveBatch() skips the remaining grids.
+     */
+    void setStopToken(std::stop_token token);
+
+    /**
+     * @return true if the last solve gave up because its budget ran out or it was cancelled
+     */
+    bool budgetExceeded() const;
+
+    /**
+     * @brief solveBatch solve \a count grids of N*N values stored back to back in \a grids
+     *
+     * The grids are distributed over a fixed pool of worker threads ("threads" setting),
+     * every worker keeps its own solver state. With "lockstepBatch" 9x9 grids are propagated
+     * in groups of SudokuSimd::BatchSize first, only grids that need branching are searched one by one. Solutions are written to \a outGrids in input
+     * order, grids without solution are filled with 0. The GPU implementation searches up to
+     * "gpuBatchSize" grids per kernel launch instead of using the worker threads. Nothing is logged.
+     * @return number of solved grids
+     */
+    size_t solveBatch(const int* grids, int* outGrids, size_t count);
+
+    /**
+     * @brief countSolutions count the solutions of \a grid (N*N values, 0 for empty cells) up to \a cap
+     *
+     * With cap 2 this checks that a recognized puzzle has exactly one solution. The search
+     * stops as soon as \a cap solutions are found and always runs on the CPU.
+     * @param outSolution if set, receives the first solution found
+     * @return number of solutions, at most \a cap
+     */
+    size_t countSolutions(const int* grid, size_t cap = 2, int* outSolution = nullptr);
+
+    /**
+     * @brief GivenChange new \a value of the given in \a cell (row major), 0 removes it
+     */
+    struct GivenChange
+    {
+        size_t cell;
+        int value;
+    };
+
+    /**
+     * @brief resolve solve \a previousGrid after \a changes of its givens, typically a few digits flipped by the OCR
+     *
+     * If the previous solution still agrees with all givens it is returned without a search.
+     * Otherwise the grid is propagated again, starting from the propagated state of the previous
+     * resolve() call if givens were only added, and the search tries the values of \a previousSolution first.
+     * Always runs on the CPU.
+     * @param previousSolution solution of \a previousGrid, null or starting with 0 if there was none
+     * @return false if the changed grid has no solution, \a outSolution is unchanged then
+     * @throws std::runtime_error for a change outside of the grid or with a value above N
+     */
+    bool resolve(const int* previousGrid, const int* previousSolution, const std::vector<GivenChange>& changes, int* outSolution);
+
+    /**
+     * @brief solveTolerant solve \a grid, replacing up to "ocrFlips" uncertain givens by one of their OCR \a alternatives
+     *
+     * A given is uncertain if another digit of its cell scores at least "ocrRatio" of the recognized one.
+     * Combinations with fewer replacements are tried first, all of them start from the propagated
+     * certain givens and share the propagation of their common prefix on the trail. exec() uses this
+     * if a grid has no solution and in_alternatives is filled.
+     * @param alternatives N*N lists of candidates, best first
+     * @param outGrid if set, receives the givens of the solution, with the replaced digits
+     * @return false if no combination has a solution
+     */
+    bool solveTolerant(const int* grid, const std::vector<Alternatives>& alternatives, int* outSolution, int* outGrid = nullptr);
+
+    /**
+     * @return solutions found per grid of the last exec() call, capped by the "solutionCap" setting,
+     *         empty if the setting is 0 or the implementation is not CPU
+     */
+    const std::vector<size_t>& solutionCounts() const;
+
+    /**
+     * @return givens per non empty grid of the last exec() call with the digits replaced by solveTolerant(),
+     *         empty for grids that were solved as recognized or not at all
+     */
+    const std::vector<std::vector<int>>& correctedGivens() const;
+
+    /**
+     * @return cache of exec() with its hit and miss counters, null if the "solutionCache" setting is 0
+     */
+    const SolutionCache* solutionCache() const;
+
+    /**
+     * @return grids per second of the last solveBatch() call
+     */
+    double throughput() const;
+
+    /**
+     * @return number of trial values set by the search during the last exec() or solveBatch() call
+     */
+    size_t searchNodes() const;
+
+    /**
+     * @brief stats search counters and puzzle latencies of the last exec() or solveBatch() call
+     */
+    const SolverStats& stats() const;
+
 private:
     unsigned int m_N;
     unsigned int m_possArrayCellSize;
@@ -49,10 +264,60 @@ private:
     cl_mem m_dFlags;
     cl_mem m_dDebugArray;
 
+    // grids and flags of SudokuBatch, grown on demand
+    cl_mem m_dBatchArray;
+    cl_mem m_dBatchFlags;
+    size_t m_batchCapacity;
+    // one search stack per grid of SudokuSearch, grown on demand
+    cl_mem m_dSearchStacks;
+    size_t m_stackCapacity;
+
     cl_program m_Program;
     cl_kernel  m_SolverKernel;
+    cl_kernel  m_BatchKernel;
+    cl_kernel  m_SearchKernel;
+    cl_kernel  m_MaskBatchKernel;
+    cl_kernel  m_MaskSearchKernel;
 
+    // set as soon as one branch of a parallel search found a solution, all other branches give up
     std::atomic<bool> m_solved = false;
 
+    std::unique_ptr<DancingLinks> m_exactCover;
+    std::unique_ptr<Bitboard9> m_bitboard;
+    std::unique_ptr<SolutionCache> m_cache;
+
     int m_logLevel;
+
+    // Deduction flags used by Field::solveStep
+    unsigned m_deductions;
+    // 9x9 singles are propagated by SudokuSimd
+    bool m_simd;
+    Branching m_branching;
+
+    // solveTrialTrail() tries these values first, only set during resolve()
+    const int* m_valueHint;
+    // Field<m_N> after propagating m_resolveGrid, the starting point of the next resolve()
+    std::shared_ptr<void> m_resolveField;
+    std::vector<int> m_resolveGrid;
+
+    // budget of the running solve, see startBudget()
+    std::stop_token m_stopToken;
+    bool m_budgetActive;
+    size_t m_nodeBudget;
+    std::chrono::steady_clock::time_point m_deadline;
+    std::atomic<size_t> m_budgetNodes = 0;
+    std::atomic<bool> m_budgetExceeded = false;
+
+    // solutions counted by the last DoCompute() if "solutionCap" is set
+    size_t m_solutionCount;
+    std::vector<size_t> m_solutionCounts;
+    std::vector<std::vector<int>> m_correctedGivens;
+
+    std::vector<SolverStats> m_workerStats;
+    SolverStats m_stats;
+
+    std::unique_ptr<ThreadPool> m_pool;
+    std::vector<std::unique_ptr<DancingLinks>> m_workerExactCover;
+    std::vector<std::unique_ptr<Bitboard9>> m_workerBitboard;
+    double m_throughput;
 };
@@ -0,0 +1,1134 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "SolverStats.h"
+#include "SudokuTrace.h"
+
+/**
+ * @brief FieldGeometry index tables of a NxN sudoku, computed at compile time
+ *
+ * Units are numbered rows (0..N-1), columns (N..2N-1), blocks (2N..3N-1).
+ * The tables are shared by every Field<N>, copying a field never copies them.
+ */
+template<size_t N>
+struct FieldGeometry
+{
+    static constexpr size_t rootN()
+    {
+        size_t r = 1;
+        while (r * r < N)
+            ++r;
+        return r;
+    }
+
+    static constexpr size_t R = rootN();
+    static_assert(R * R == N, "only square numbers are allowed for N, otherwise we cant have blocks");
+
+    static constexpr size_t NumCells = N * N;
+    static constexpr size_t NumUnits = 3 * N;
+    static constexpr size_t NumPeers = 3 * N - 2 * R - 1;
+
+    using Index = std::conditional_t<(NumCells <= 256), uint8_t, uint16_t>;
+
+    static constexpr size_t row(size_t cell) { return cell / N; }
+    static constexpr size_t col(size_t cell) { return cell % N; }
+    static constexpr size_t block(size_t cell) { return (row(cell) / R) * R + col(cell) / R; }
+
+    static constexpr std::array<std::array<Index, N>, NumUnits> units = []
+    {
+        std::array<std::array<Index, N>, NumUnits> u{};
+        for (size_t i = 0; i < N; ++i)
+        {
+            for (size_t j = 0; j < N; ++j)
+            {
+                u[i][j] = Index(N * i + j);
+                u[N + i][j] = Index(N * j + i);
+                u[2 * N + i][j] = Index(N * (R * (i / R) + j / R) + R * (i % R) + j % R);
+            }
+        }
+        return u;
+    }();
+
+    /// the row, column and block unit of each cell
+    static constexpr std::array<std::array<Index, 3>, NumCells> cellUnits = []
+    {
+        std::array<std::array<Index, 3>, NumCells> cu{};
+        for (size_t i = 0; i < NumCells; ++i)
+        {
+            cu[i] = {Index(row(i)), Index(N + col(i)), Index(2 * N + block(i))};
+        }
+        return cu;
+    }();
+
+    /// boards up to 25x25 keep a peer table, larger ones walk the units (the table would be 1.4 MB for 64x64)
+    static constexpr bool PeerTable = NumCells <= 625;
+
+    /// all other cells sharing a row, column or block with a cell, empty without PeerTable
+    static constexpr std::array<std::array<Index, NumPeers>, PeerTable ? NumCells : 0> peers = []
+    {
+        std::array<std::array<Index, NumPeers>, PeerTable ? NumCells : 0> p{};
+        for (size_t i = 0; i < p.size(); ++i)
+        {
+            size_t n = 0;
+            for (size_t j = 0; j < NumCells; ++j)
+            {
+                if (j != i && (row(j) == row(i) || col(j) == col(i) || block(j) == block(i)))
+                {
+                    p[i][n++] = Index(j);
+                }
+            }
+        }
+        return p;
+    }();
+
+    /**
+     * @brief forEachPeer call \a f with every peer of \a cell
+     *
+     * Without PeerTable the peers are visited row by row: the whole row of the cell,
+     * the block segment in the other rows of its band and the column cell in the rows
+     * outside the band. Every visited row is touched once and in ascending order.
+     */
+    template<typename F>
+    static void forEachPeer(size_t cell, F&& f)
+    {
+        if constexpr (PeerTable)
+        {
+            for (auto peer : peers[cell])
+                f(peer);
+        }
+        else
+        {
+            const size_t r = row(cell), c = col(cell);
+            const size_t blockCol = (c / R) * R;
+            for (size_t other = 0; other < N; ++other)
+            {
+                const size_t base = N * other;
+                if (other == r)
+                {
+                    for (size_t k = 0; k < N; ++k)
+                    {
+                        if (k != c)
+                            f(base + k);
+                    }
+                }
+                else if (other / R == r / R)
+                {
+                    for (size_t k = blockCol; k < blockCol + R; ++k)
+                        f(base + k);
+                }
+                else
+                {
+                    f(base + c);
+                }
+            }
+        }
+    }
+};
+
+/**
+ * @brief Deduction higher order rules Field::solveStep() can apply in addition to naked and hidden singles
+ */
+enum Deduction : unsigned
+{
+    NAKED_PAIRS         = 1 << 0,
+    HIDDEN_PAIRS        = 1 << 1,
+    POINTING_PAIRS      = 1 << 2,
+    BOX_LINE_REDUCTION  = 1 << 3,
+    X_WING              = 1 << 4
+};
+
+/**
+ * @brief BranchCell tie-break between the unsolved cells with the fewest candidates, see Field::branchCell()
+ */
+enum BranchCell : unsigned
+{
+    FIRST_CELL      = 0,    // first in row major order
+    MOST_UNSOLVED   = 1,    // most unsolved cells in its row, column and block (degree)
+    MOST_CONFLICTS  = 2     // most failed branches on the cell so far
+};
+
+/**
+ * @brief DirtySet fixed size set of indices waiting to be processed, stored as bitmask so copying a field stays cheap
+ */
+template<size_t Size>
+class DirtySet
+{
+public:
+    void insert(size_t index) { m_words[index / 64] |= uint64_t(1) << (index % 64); }
+
+    bool empty() const
+    {
+        return std::ranges::all_of(m_words, [](uint64_t w){ return w == 0; });
+    }
+
+    /**
+     * @brief pop remove and return the smallest index, the set must not be empty
+     */
+    size_t pop()
+    {
+        for (size_t i = 0; i < m_words.size(); ++i)
+        {
+            if (m_words[i] != 0)
+            {
+                size_t bit = std::countr_zero(m_words[i]);
+                m_words[i] &= m_words[i] - 1;
+                return 64 * i + bit;
+            }
+        }
+
+        assert(false);
+        return Size;
+    }
+
+private:
+    std::array<uint64_t, (Size + 63) / 64> m_words{};
+};
+
+template<size_t N>
+class Cell
+{
+public:
+    using Mask = std::conditional_t<(N <= 16), uint16_t, std::conditional_t<(N <= 32), uint32_t, uint64_t>>;
+
+    /// bit (value - 1) is set if value is still possible
+    static constexpr Mask AllPossible = Mask(N >= 64 ? ~uint64_t(0) : (uint64_t(1) << N) - 1);
+
+    static constexpr Mask bit(int value) { return Mask(Mask(1) << (value - 1)); }
+
+public:
+    Cell() : m_possible(AllPossible), m_value(0) {}
+
+    /**
+     * @return -1 if invalid (no solution possible);
+     *          0 if no value set yet (multiple possibilities left)
+     *          1-N if value set
+     */
+    int value() const { return m_value; }
+
+    bool valid() const { return m_value > -1; }
+    bool solved() const { return m_value > 0; }
+
+    /**
+     * @brief setValue set cell to \a value if possible
+     * @return false if \a value is not in list of possiblities
+     */
+    bool setValue(int value);
+    void disable(int value) { m_possible &= ~bit(value); }
+
+    bool possible(int value) const;
+
+    size_t possibilities() const { return std::popcount(m_possible); }
+    Mask candidates() const { return m_possible; }
+
+    /**
+     * @brief remove disable all values in \a values
+     * @return true if at least one of them was still possible
+     */
+    bool remove(Mask values)
+    {
+        Mask old = m_possible;
+        m_possible &= ~values;
+        return old != m_possible;
+    }
+
+    operator int() const { return value(); }
+
+    /**
+     * @brief solve write value if only one possibility left
+     * @return true if value was set or marked as invalid, false if more than one possibility remains
+     */
+    bool solve();
+
+private:
+    Mask m_possible;
+    int8_t m_value;
+};
+
+template<size_t N>
+class Field
+{
+public:
+    using Geometry = FieldGeometry<N>;
+    using Mask = typename Cell<N>::Mask;
+
+    struct TrailEntry
+    {
+        typename Geometry::Index index;
+        Cell<N> cell;
+    };
+    using Trail = std::vector<TrailEntry>;
+
+    Field() = default;
+
+    /**
+     * @brief setTrail record the previous state of every cell changed from now on in \a trail,
+     *        changes can then be undone with rollback() instead of copying the field.
+     *        nullptr stops recording. Copies of the field share the trail pointer.
+     */
+    void setTrail(Trail* trail) { m_trail = trail; }
+
+    /**
+     * @return trail position to rollback() to, requires a trail
+     */
+    size_t checkpoint() const { return m_trail->size(); }
+
+    /**
+     * @brief rollback restore all cells changed after \a checkpoint was taken
+     */
+    void rollback(size_t checkpoint);
+
+    /**
+     * @brief setValue set cell with coords (\a col, \a row) to \a value if possible
+     * @returns false if \a value is not in list of possiblities for cell
+     */
+    bool setValue(size_t row, size_t col, int value);
+    bool possible(size_t row, size_t col, int value) const { return cell(row, col).possible(value); }
+    /**
+     * @brief exclude remove \a value from the candidates of cell (\a col, \a row),
+     *        a cell left without candidates makes the next solveStep() fail
+     */
+    void exclude(size_t row, size_t col, int value) { eliminate(N * row + col, Cell<N>::bit(value)); }
+    int value(size_t row, size_t col) const { return cell(row, col).value(); }
+
+    /**
+     * @brief solveStep solve cells with only one possibility left
+     *
+     * Only cells and units changed since the last step are looked at: every cell that dropped to
+     * at most one candidate and every unit where a value dropped to one position is queued
+     * when the candidate is removed. If no single was found, the enabled \a deductions
+     * (Deduction flags) are tried in turn until one of them removes candidates.
+     * @param counts if set, the changes are added to the counter of the rule that made them
+     * @return if field can still be valid and number of changes (solved cells or removed candidates) in this step
+     */
+    std::tuple<bool, int> solveStep(unsigned deductions = 0, RuleCounts* counts = nullptr);
+
+    /**
+     * @brief candidateMasks write the candidates of all cells to \a outMasks (row major),
+     *        solved cells as the bit of their value
+     */
+    void candidateMasks(Mask* outMasks) const;
+
+    /**
+     * @brief restrictCandidates reduce every cell to its candidates in \a masks, which must be a subset
+     *        of the current ones. Cells left with one candidate are set.
+     * @return number of changes (cells that lost candidates and solved cells)
+     */
+    int restrictCandidates(const Mask* masks);
+
+    /**
+     * @brief clearPending forget the cells and units queued for the next solveStep(),
+     *        only valid if singles were already propagated by other means
+     */
+    void clearPending()
+    {
+        m_pendingCells = {};
+        m_dirtyUnits = {};
+    }
+
+    void print(int recursionDepth) const;
+
+    bool valid() const;
+    bool solved() const;
+    size_t numSolvedCells() const;
+
+    /**
+     * @return how many cells currently solved with \a value
+     */
+    size_t valueCount(int value) const;
+    /**
+     * @return number with the most already solved cells but not completely solved
+     */
+    size_t mostlySolvedNumber() const;
+
+    /**
+     * @brief mostSolvedCell finds yet unsolved cell with fewest remaining possiblities,
+     *        the scan stops at the first cell with two
+     * @param outRow row coord of cell
+     * @param outCol col coord of cell
+     * @return how many remaining possibilties
+     */
+    size_t mostSolvedCell(size_t& outRow, size_t& outCol) const;
+
+    /**
+     * @brief branchCell unsolved cell with the fewest candidates, ties are broken by \a rule
+     * @param conflicts failed branches per cell (row major), only read for MOST_CONFLICTS
+     * @param seed remaining ties go to the cell with the largest hash of index and \a seed, 0 keeps the first
+     * @return how many remaining possibilties
+     */
+    size_t branchCell(BranchCell rule, const uint32_t* conflicts, uint32_t seed, size_t& outRow, size_t& outCol) const;
+
+    /**
+     * @brief branchValues candidates of cell (\a col, \a row) in the order to try them
+     *
+     * Ascending by default. With \a leastConstraining the values possible in the fewest other cells of
+     * the row, column and block come first, they remove the fewest candidates when set.
+     * @return number of values written to \a outValues
+     */
+    size_t branchValues(size_t row, size_t col, bool leastConstraining, std::array<int, N>& outValues) const;
+
+private:
+    const Cell<N>& cell(size_t row, size_t col) const
+    {
+        assert(row < N && col < N);
+        return m_cells[N * row + col];
+    }
+
+    /**
+     * @brief solveUnit set all values with only one position left in \a unit
+     * @return false if a value that is not solved in \a unit has no position left
+     */
+    bool solveUnit(size_t unit, int& changes);
+
+    using Counts = std::array<std::array<uint8_t, N>, Geometry::NumUnits>;
+
+    /// bit k is set if the k-th cell of \a unit is unsolved and \a value is possible there
+    uint64_t positions(size_t unit, Mask value) const;
+
+    /**
+     * @brief eliminate remove \a values from the candidates of cell \a index
+     * @return 1 if at least one candidate was removed, 0 otherwise
+     */
+    int eliminate(size_t index, Mask values);
+
+    /**
+     * @brief count add \a delta to the unit counts of all \a values of cell \a index,
+     *        units where a value is left with at most one position are marked dirty
+     */
+    void count(size_t index, Mask values, int delta);
+
+    int nakedPairs();
+    int hiddenPairs();
+    int pointingPairs();
+    int boxLineReduction();
+    int xWing();
+
+    void record(size_t index)
+    {
+        m_trail->push_back({typename Geometry::Index(index), m_cells[index]});
+    }
+
+private:
+    std::array<Cell<N>, N * N> m_cells;
+
+    /// number of cells per unit and value where the value is still a candidate
+    Counts m_counts = []
+    {
+        Counts c;
+        for (auto& unit : c)
+            unit.fill(uint8_t(N));
+        return c;
+    }();
+
+    /// values set in each unit, so solveUnit() does not walk the (strided) cells for them
+    std::array<Mask, Geometry::NumUnits> m_placed{};
+
+    /// unsolved cells with at most one candidate left
+    DirtySet<Geometry::NumCells> m_pendingCells;
+    /// units where a value count dropped to one or zero
+    DirtySet<Geometry::NumUnits> m_dirtyUnits;
+
+    Trail* m_trail = nullptr;
+};
+
+/**
+ * @brief printField print \a field of size \a N as grid, empty cells are left blank
+ */
+template<typename F>
+void printField(size_t N, const F& field, int recursionDepth);
+
+/**
+ * @brief withFieldSize call \a f with std::integral_constant<size_t, N> of the matching specialization
+ * @throws std::runtime_error if there is no specialization for \a N
+ */
+template<typename F>
+decltype(auto) withFieldSize(size_t N, F&& f);
+
+// =========================================================
+
+template<size_t N>
+bool Cell<N>::possible(int value) const
+{
+    assert(value > 0 && value <= int(N));
+
+    if (!valid())
+    {
+        return false;
+    }
+
+    return m_possible & bit(value);
+}
+
+template<size_t N>
+bool Cell<N>::setValue(int value)
+{
+    if (!(m_possible & bit(value)))
+    {
+        return false;
+    }
+
+    m_possible = 0;
+    m_value = value;
+    return true;
+}
+
+template<size_t N>
+bool Cell<N>::solve()
+{
+    if (m_possible == 0)
+    {
+        // no possible solutions left
+        m_value = -1;
+        return true;
+    }
+    else if (m_possible & (m_possible - 1))
+    {
+        // undecided
+        m_value = 0;
+        return false;
+    }
+    else
+    {
+        // only value possible
+        m_value = std::countr_zero(m_possible) + 1;
+        return true;
+    }
+}
+
+template<size_t N>
+bool Field<N>::setValue(size_t row, size_t col, int value)
+{
+    assert(row < N && col < N);
+    size_t index = N * row + col;
+    if (!m_cells[index].possible(value))
+    {
+        return false;
+    }
+
+    if (m_trail)
+        record(index);
+    count(index, m_cells[index].candidates(), -1);
+    m_cells[index].setValue(value);
+    for (auto unit : Geometry::cellUnits[index])
+        m_placed[unit] |= Cell<N>::bit(value);
+
+    Geometry::forEachPeer(index, [this, value](size_t peer) { eliminate(peer, Cell<N>::bit(value)); });
+
+    return true;
+}
+
+template<size_t N>
+void Field<N>::rollback(size_t checkpoint)
+{
+    while (m_trail->size() > checkpoint)
+    {
+        const TrailEntry& e = m_trail->back();
+        Mask current = m_cells[e.index].candidates();
+        Mask restored = e.cell.candidates();
+        count(e.index, current & ~restored, -1);
+        count(e.index, restored & ~current, +1);
+
+        const Cell<N>& cell = m_cells[e.index];
+        if (cell.solved() && !e.cell.solved())
+        {
+            for (auto unit : Geometry::cellUnits[e.index])
+                m_placed[unit] &= ~Cell<N>::bit(cell.value());
+        }
+
+        m_cells[e.index] = e.cell;
+        if (!e.cell.solved() && e.cell.possibilities() <= 1)
+            m_pendingCells.insert(e.index);
+
+        m_trail->pop_back();
+    }
+}
+
+template<size_t N>
+void Field<N>::count(size_t index, Mask values, int delta)
+{
+    for (auto unit : Geometry::cellUnits[index])
+    {
+        for (Mask v = values; v != 0; v &= v - 1)
+        {
+            uint8_t& c = m_counts[unit][std::countr_zero(v)];
+            c = uint8_t(c + delta);
+            if (c <= 1)
+                m_dirtyUnits.insert(unit);
+        }
+    }
+}
+
+template<size_t N>
+bool Field<N>::solveUnit(size_t unit, int& changes)
+{
+    const Mask placed = m_placed[unit];
+    for (size_t v = 0; v < N; ++v)
+    {
+        if (m_counts[unit][v] == 0 && !(placed & Cell<N>::bit(v + 1)))
+            return false;
+
+        // solved cells have no candidates, so the only position is an unsolved cell
+        if (m_counts[unit][v] != 1)
+            continue;
+
+        for (auto i : Geometry::units[unit])
+        {
+            if (m_cells[i].candidates() & Cell<N>::bit(v + 1))
+            {
+                setValue(i / N, i % N, v + 1);
+                ++changes;
+                break;
+            }
+        }
+    }
+
+    return true;
+}
+
+template<size_t N>
+std::tuple<bool, int> Field<N>::solveStep(unsigned deductions, RuleCounts* counts)
+{
+    int changes = 0;
+    int hidden = 0;
+    while (!m_pendingCells.empty() || !m_dirtyUnits.empty())
+    {
+        while (!m_pendingCells.empty())
+        {
+            size_t i = m_pendingCells.pop();
+            Cell<N>& cell = m_cells[i];
+            if (cell.solved())
+                continue;
+
+            // solve() only changes cells with at most one possibility left
+            if (m_trail && cell.possibilities() <= 1)
+                record(i);
+
+            if (cell.solve())
+            {
+                ++changes;
+                if (!cell.valid())
+                {
+                    return {false, changes};
+                }
+
+                setValue(i / N, i % N, cell.value());
+            }
+        }
+
+        if (!m_dirtyUnits.empty() && !solveUnit(m_dirtyUnits.pop(), hidden))
+        {
+            return {false, changes + hidden};
+        }
+    }
+
+    if (counts)
+    {
+        (*counts)[size_t(Rule::NakedSingle)] += changes;
+        (*counts)[size_t(Rule::HiddenSingle)] += hidden;
+    }
+    changes += hidden;
+
+    if (changes == 0 && deductions != 0)
+    {
+        Rule rule = Rule::Count;
+        if (deductions & POINTING_PAIRS)
+            std::tie(changes, rule) = std::tuple(pointingPairs(), Rule::PointingPairs);
+        if (changes == 0 && (deductions & BOX_LINE_REDUCTION))
+            std::tie(changes, rule) = std::tuple(boxLineReduction(), Rule::BoxLineReduction);
+        if (changes == 0 && (deductions & NAKED_PAIRS))
+            std::tie(changes, rule) = std::tuple(nakedPairs(), Rule::NakedPairs);
+        if (changes == 0 && (deductions & HIDDEN_PAIRS))
+            std::tie(changes, rule) = std::tuple(hiddenPairs(), Rule::HiddenPairs);
+        if (changes == 0 && (deductions & X_WING))
+            std::tie(changes, rule) = std::tuple(xWing(), Rule::XWing);
+
+        if (counts && changes > 0)
+            (*counts)[size_t(rule)] += changes;
+    }
+
+    return {true, changes};
+}
+
+template<size_t N>
+uint64_t Field<N>::positions(size_t unit, Mask value) const
+{
+    uint64_t rtn = 0;
+    for (size_t k = 0; k < N; ++k)
+    {
+        if (m_cells[Geometry::units[unit][k]].candidates() & value)
+        {
+            rtn |= uint64_t(1) << k;
+        }
+    }
+    return rtn;
+}
+
+template<size_t N>
+int Field<N>::eliminate(size_t index, Mask values)
+{
+    Cell<N>& c = m_cells[index];
+    Mask removed = c.candidates() & values;
+    if (c.solved() || removed == 0)
+    {
+        return 0;
+    }
+
+    if (m_trail)
+        record(index);
+    c.remove(removed);
+    count(index, removed, -1);
+
+    if (c.possibilities() <= 1)
+        m_pendingCells.insert(index);
+    return 1;
+}
+
+template<size_t N>
+int Field<N>::nakedPairs()
+{
+    int changes = 0;
+    for (size_t unit = 0; unit < Geometry::NumUnits; ++unit)
+    {
+        const auto& cells = Geometry::units[unit];
+        for (size_t a = 0; a < N; ++a)
+        {
+            Mask pair = m_cells[cells[a]].candidates();
+            if (std::popcount(pair) != 2)
+                continue;
+
+            for (size_t b = a + 1; b < N; ++b)
+            {
+                if (m_cells[cells[b]].candidates() != pair)
+                    continue;
+
+                // both values are bound to cells a and b
+                for (size_t k = 0; k < N; ++k)
+                {
+                    if (k != a && k != b)
+                        changes += eliminate(cells[k], pair);
+                }
+            }
+        }
+    }
+    return changes;
+}
+
+template<size_t N>
+int Field<N>::hiddenPairs()
+{
+    int changes = 0;
+    std::array<uint64_t, N> pos;
+    for (size_t unit = 0; unit < Geometry::NumUnits; ++unit)
+    {
+        for (size_t v = 0; v < N; ++v)
+        {
+            pos[v] = m_counts[unit][v] == 2 ? positions(unit, Cell<N>::bit(v + 1)) : 0;
+        }
+
+        for (size_t v1 = 0; v1 < N; ++v1)
+        {
+            if (std::popcount(pos[v1]) != 2)
+                continue;
+
+            for (size_t v2 = v1 + 1; v2 < N; ++v2)
+            {
+                if (pos[v2] != pos[v1])
+                    continue;
+
+                // both cells can only hold these two values
+                Mask others = Mask(Cell<N>::AllPossible & ~(Cell<N>::bit(v1 + 1) | Cell<N>::bit(v2 + 1)));
+                for (uint64_t p = pos[v1]; p != 0; p &= p - 1)
+                {
+                    changes += eliminate(Geometry::units[unit][std::countr_zero(p)], others);
+                }
+            }
+        }
+    }
+    return changes;
+}
+
+template<size_t N>
+int Field<N>::pointingPairs()
+{
+    constexpr size_t R = Geometry::R;
+    int changes = 0;
+    for (size_t block = 0; block < N; ++block)
+    {
+        const size_t blockRow = block / R;
+        const size_t blockCol = block % R;
+        for (int value = 1; value <= int(N); ++value)
+        {
+            uint64_t pos = positions(2 * N + block, Cell<N>::bit(value));
+            if (pos == 0)
+                continue;
+
+            for (size_t i = 0; i < R; ++i)
+            {
+                uint64_t rowMask = ((uint64_t(1) << R) - 1) << (i * R);
+                if ((pos & ~rowMask) == 0)
+                {
+                    // value is confined to one row of the block, remove it from the rest of that row
+                    size_t row = blockRow * R + i;
+                    for (size_t col = 0; col < N; ++col)
+                    {
+                        if (col / R != blockCol)
+                            changes += eliminate(N * row + col, Cell<N>::bit(value));
+                    }
+                }
+
+                uint64_t colMask = 0;
+                for (size_t k = i; k < N; k += R)
+                    colMask |= uint64_t(1) << k;
+                if ((pos & ~colMask) == 0)
+                {
+                    // ... or to one column
+                    size_t col = blockCol * R + i;
+                    for (size_t row = 0; row < N; ++row)
+                    {
+                        if (row / R != blockRow)
+                            changes += eliminate(N * row + col, Cell<N>::bit(value));
+                    }
+                }
+            }
+        }
+    }
+    return changes;
+}
+
+template<size_t N>
+int Field<N>::boxLineReduction()
+{
+    constexpr size_t R = Geometry::R;
+    int changes = 0;
+    for (size_t line = 0; line < N; ++line)
+    {
+        for (int value = 1; value <= int(N); ++value)
+        {
+            uint64_t rowPos = positions(line, Cell<N>::bit(value));
+            uint64_t colPos = positions(N + line, Cell<N>::bit(value));
+
+            for (size_t j = 0; j < R; ++j)
+            {
+                uint64_t segment = ((uint64_t(1) << R) - 1) << (j * R);
+
+                if (rowPos != 0 && (rowPos & ~segment) == 0)
+                {
+                    // value of this row is confined to one block, remove it from the other rows of the block
+                    size_t block = (line / R) * R + j;
+                    for (auto index : Geometry::units[2 * N + block])
+                    {
+                        if (Geometry::row(index) != line)
+                            changes += eliminate(index, Cell<N>::bit(value));
+                    }
+                }
+
+                if (colPos != 0 && (colPos & ~segment) == 0)
+                {
+                    size_t block = j * R + line / R;
+                    for (auto index : Geometry::units[2 * N + block])
+                    {
+                        if (Geometry::col(index) != line)
+                            changes += eliminate(index, Cell<N>::bit(value));
+                    }
+                }
+            }
+        }
+    }
+    return changes;
+}
+
+template<size_t N>
+int Field<N>::xWing()
+{
+    int changes = 0;
+    std::array<uint64_t, N> pos;
+    for (int value = 1; value <= int(N); ++value)
+    {
+        // base units are rows (first pass) or columns (second pass), cover units the other direction
+        for (size_t base = 0; base <= N; base += N)
+        {
+            for (size_t i = 0; i < N; ++i)
+            {
+                pos[i] = m_counts[base + i][value - 1] == 2 ? positions(base + i, Cell<N>::bit(value)) : 0;
+            }
+
+            for (size_t a = 0; a < N; ++a)
+            {
+                if (std::popcount(pos[a]) != 2)
+                    continue;
+
+                for (size_t b = a + 1; b < N; ++b)
+                {
+                    if (pos[b] != pos[a])
+                        continue;
+
+                    size_t cover = base == 0 ? N : 0;
+                    for (uint64_t p = pos[a]; p != 0; p &= p - 1)
+                    {
+                        const auto& cells = Geometry::units[cover + std::countr_zero(p)];
+                        for (size_t k = 0; k < N; ++k)
+                        {
+                            if (k != a && k != b)
+                                changes += eliminate(cells[k], Cell<N>::bit(value));
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return changes;
+}
+
+template<size_t N>
+void Field<N>::candidateMasks(Mask* outMasks) const
+{
+    for (size_t i = 0; i < N * N; ++i)
+    {
+        const Cell<N>& c = m_cells[i];
+        outMasks[i] = c.solved() ? Cell<N>::bit(c.value()) : c.candidates();
+    }
+}
+
+template<size_t N>
+int Field<N>::restrictCandidates(const Mask* masks)
+{
+    int changes = 0;
+    for (size_t i = 0; i < N * N; ++i)
+    {
+        changes += eliminate(i, Mask(~masks[i]));
+    }
+
+    for (size_t i = 0; i < N * N; ++i)
+    {
+        const Cell<N>& c = m_cells[i];
+        if (!c.solved() && std::popcount(masks[i]) == 1)
+        {
+            setValue(i / N, i % N, std::countr_zero(masks[i]) + 1);
+            ++changes;
+        }
+    }
+    return changes;
+}
+
+template<size_t N>
+bool Field<N>::solved() const
+{
+    return std::ranges::all_of(m_cells, [](const Cell<N>& cell){ return cell.solved(); });
+}
+
+template<size_t N>
+bool Field<N>::valid() const
+{
+    return std::ranges::all_of(m_cells, [](const Cell<N>& cell) { return cell.valid(); });
+}
+
+template<size_t N>
+size_t Field<N>::numSolvedCells() const
+{
+    return std::ranges::count_if(m_cells, [](const Cell<N>& cell){ return cell.solved(); });
+}
+
+template<size_t N>
+size_t Field<N>::valueCount(int value) const
+{
+    return std::ranges::count_if(m_cells, [value](const Cell<N>& cell){ return cell.value() == value; });
+}
+
+template<size_t N>
+size_t Field<N>::mostlySolvedNumber() const
+{
+    std::map<size_t, int, std::greater<size_t>> solveCountPerValueDesc;
+    for (size_t p = 1; p <= N; ++p)
+    {
+        size_t count = valueCount(p);
+        if (count < N)
+        {
+            solveCountPerValueDesc[count] = p;
+        }
+    }
+
+    return solveCountPerValueDesc.empty() ? 0 : solveCountPerValueDesc.begin()->second;
+}
+
+template<size_t N>
+size_t Field<N>::mostSolvedCell(size_t& outRow, size_t& outCol) const
+{
+    size_t minIndex = 0, value = N;
+    for (size_t i = 0; i < m_cells.size() && value > 2; ++i)
+    {
+        // propagated fields have no single candidates left, so the first cell with two is a minimum
+        auto p = m_cells[i].possibilities();
+        if (p > 0 && p < value)
+        {
+            value = p;
+            minIndex = i;
+        }
+    }
+
+    outRow = minIndex / N;
+    outCol = minIndex % N;
+    return value;
+}
+
+template<size_t N>
+size_t Field<N>::branchCell(BranchCell rule, const uint32_t* conflicts, uint32_t seed, size_t& outRow, size_t& outCol) const
+{
+    if (rule == FIRST_CELL && seed == 0)
+    {
+        return mostSolvedCell(outRow, outCol);
+    }
+
+    size_t best = 0, value = N + 1;
+    uint64_t bestKey = 0;
+    for (size_t i = 0; i < m_cells.size(); ++i)
+    {
+        auto p = m_cells[i].possibilities();
+        if (p == 0 || p > value)
+        {
+            continue;
+        }
+
+        uint64_t key = 0;
+        if (rule == MOST_UNSOLVED)
+        {
+            for (auto unit : Geometry::cellUnits[i])
+                key += N - std::popcount(m_placed[unit]);
+        }
+        else if (rule == MOST_CONFLICTS)
+        {
+            key = conflicts[i];
+        }
+
+        if (seed != 0)
+        {
+            // murmur3 finalizer, the low bits order cells of equal key differently per seed
+            uint32_t h = uint32_t(i) ^ seed;
+            h ^= h >> 16;
+            h *= 0x85EBCA6Bu;
+            h ^= h >> 13;
+            h *= 0xC2B2AE35u;
+            h ^= h >> 16;
+            key = (key << 32) | h;
+        }
+
+        if (p < value || key > bestKey)
+        {
+            value = p;
+            best = i;
+            bestKey = key;
+        }
+    }
+
+    outRow = best / N;
+    outCol = best % N;
+    return value > N ? 0 : value;
+}
+
+template<size_t N>
+size_t Field<N>::branchValues(size_t row, size_t col, bool leastConstraining, std::array<int, N>& outValues) const
+{
+    const size_t index = N * row + col;
+    const Cell<N>& c = m_cells[index];
+
+    size_t n = 0;
+    for (int v = 1; v <= int(N); ++v)
+    {
+        if (c.possible(v))
+            outValues[n++] = v;
+    }
+
+    if (leastConstraining)
+    {
+        // every unit count includes the cell itself, the constant offset does not change the order
+        std::array<uint32_t, N + 1> score{};
+        for (size_t k = 0; k < n; ++k)
+        {
+            for (auto unit : Geometry::cellUnits[index])
+                score[outValues[k]] += m_counts[unit][outValues[k] - 1];
+        }
+
+        std::stable_sort(outValues.begin(), outValues.begin() + n, [&score](int a, int b) { return score[a] < score[b]; });
+    }
+
+    return n;
+}
+
+template<size_t N>
+void Field<N>::print(int recursionDepth) const
+{
+    printField(N, m_cells, recursionDepth);
+}
+
+template<typename F>
+void printField(size_t N, const F& field, int recursionDepth)
+{
+    size_t r = 1;
+    while (r * r < N)
+        ++r;
+
+    for (size_t i = 0; i < N + r + 1; i++)
+    {
+        printIndent(recursionDepth);
+        for (size_t j = 0; j < N + r + 1; j++)
+        {
+            if (i % (r + 1) == 0)
+                std::cout << "--";
+            else
+            {
+                if (j % (r + 1) == 0)
+                    std::cout << "|";
+                else
+                {
+                    size_t row = i - (i / (r + 1) + 1);
+                    size_t col = j - (j / (r + 1) + 1);
+
+                    int value = field[N * row + col];
+                    if (value == 0)
+                        std::cout << " ";
+                    else
+                        std::cout << value;
+                }
+
+                std::cout << " ";
+            }
+        }
+
+        std::cout << std::endl;
+    }
+}
+
+template<typename F>
+decltype(auto) withFieldSize(size_t N, F&& f)
+{
+    switch (N)
+    {
+    case 4:
+        return f(std::integral_constant<size_t, 4>{});
+    case 9:
+        return f(std::integral_constant<size_t, 9>{});
+    case 16:
+        return f(std::integral_constant<size_t, 16>{});
+    case 25:
+        return f(std::integral_constant<size_t, 25>{});
+    case 36:
+        return f(std::integral_constant<size_t, 36>{});
+    case 49:
+        return f(std::integral_constant<size_t, 49>{});
+    case 64:
+        return f(std::integral_constant<size_t, 64>{});
+    default:
+        throw std::runtime_error("Unsupported sudoku size");
+    }
+}
@@ -0,0 +1,398 @@
+#include "SudokuSimd.h"
+#include "SudokuField.h"
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #define SUDOKU_SIMD_X86
+    #include <immintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #endif
+#endif
+
+#ifdef SUDOKU_SIMD_X86
+
+// the AVX2 functions are compiled for AVX2 without changing the flags of the rest of the build,
+// they are only called after supported() checked the CPU
+#if defined(_MSC_VER)
+    #define AVX2_TARGET
+#else
+    #define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+namespace
+{
+/// source lane of every 16 bit result lane, -1 for zero
+using LaneMap = std::array<int, 16>;
+
+/**
+ * @brief ShuffleControl pshufb masks for a 16 bit lane permutation over the full register,
+ *        \a same picks lanes from the same 128 bit half, \a cross from the swapped halves
+ */
+struct ShuffleControl
+{
+    std::array<int8_t, 32> same;
+    std::array<int8_t, 32> cross;
+};
+
+constexpr ShuffleControl makeShuffle(const LaneMap& source)
+{
+    ShuffleControl s{};
+    for (int i = 0; i < 16; ++i)
+    {
+        int src = source[i];
+        bool sameHalf = src >= 0 && src / 8 == i / 8;
+        for (int b = 0; b < 2; ++b)
+        {
+            int8_t byte = src < 0 ? int8_t(-128) : int8_t((src % 8) * 2 + b);
+            s.same[2 * i + b] = sameHalf ? byte : int8_t(-128);
+            s.cross[2 * i + b] = src >= 0 && !sameHalf ? byte : int8_t(-128);
+        }
+    }
+    return s;
+}
+
+/// lane i gets lane i + k of the row
+constexpr LaneMap rotation(int k)
+{
+    LaneMap l{};
+    for (int i = 0; i < 16; ++i)
+        l[i] = (i + k) % 16;
+    return l;
+}
+
+/// lane i gets the k-th next lane of its block (lanes 0-2, 3-5, 6-8), unused lanes are cleared
+constexpr LaneMap blockRotation(int k)
+{
+    LaneMap l{};
+    for (int i = 0; i < 16; ++i)
+        l[i] = i < 9 ? 3 * (i / 3) + (i % 3 + k) % 3 : -1;
+    return l;
+}
+
+constexpr ShuffleControl Rotate1 = makeShuffle(rotation(1));
+constexpr ShuffleControl Rotate2 = makeShuffle(rotation(2));
+constexpr ShuffleControl Rotate4 = makeShuffle(rotation(4));
+constexpr ShuffleControl BlockRotate1 = makeShuffle(blockRotation(1));
+constexpr ShuffleControl BlockRotate2 = makeShuffle(blockRotation(2));
+
+/**
+ * @brief Count values seen at least once and at least twice in a set of cells
+ */
+struct Count
+{
+    __m256i once;
+    __m256i twice;
+};
+
+AVX2_TARGET inline __m256i shuffle(__m256i x, const ShuffleControl& c)
+{
+    __m256i swapped = _mm256_permute2x128_si256(x, x, 0x01);
+    __m256i same = _mm256_shuffle_epi8(x, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c.same.data())));
+    __m256i cross = _mm256_shuffle_epi8(swapped, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c.cross.data())));
+    return _mm256_or_si256(same, cross);
+}
+
+AVX2_TARGET inline void add(Count& c, __m256i once, __m256i twice)
+{
+    c.twice = _mm256_or_si256(c.twice, _mm256_or_si256(twice, _mm256_and_si256(c.once, once)));
+    c.once = _mm256_or_si256(c.once, once);
+}
+
+AVX2_TARGET inline void addShuffled(Count& c, const Count& other, const ShuffleControl& s)
+{
+    add(c, shuffle(other.once, s), shuffle(other.twice, s));
+}
+
+/// every lane gets the count of the whole row
+AVX2_TARGET inline Count rowCount(__m256i row)
+{
+    Count c{row, _mm256_setzero_si256()};
+    addShuffled(c, Count(c), Rotate1);
+    addShuffled(c, Count(c), Rotate2);
+    addShuffled(c, Count(c), Rotate4);
+    add(c, _mm256_permute2x128_si256(c.once, c.once, 0x01), _mm256_permute2x128_si256(c.twice, c.twice, 0x01));
+    return c;
+}
+
+/// every lane gets the count of its block, \a band holds the lane wise count of the three rows of the band
+AVX2_TARGET inline Count blockCount(const Count& band)
+{
+    Count c = band;
+    addShuffled(c, band, BlockRotate1);
+    addShuffled(c, band, BlockRotate2);
+    return c;
+}
+
+AVX2_TARGET bool propagateAvx2(uint16_t* candidates)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi16(1);
+    const __m256i all = _mm256_setr_epi16(0x1FF, 0x1FF, 0x1FF, 0x1FF, 0x1FF, 0x1FF, 0x1FF, 0x1FF, 0x1FF, 0, 0, 0, 0, 0, 0, 0);
+
+    // one row per register, lanes 9-15 stay zero
+    alignas(32) uint16_t grid[9][16] = {};
+    for (int r = 0; r < 9; ++r)
+    {
+        std::memcpy(grid[r], candidates + 9 * r, 9 * sizeof(uint16_t));
+    }
+
+    __m256i rows[9];
+    for (int r = 0; r < 9; ++r)
+    {
+        rows[r] = _mm256_load_si256(reinterpret_cast<const __m256i*>(grid[r]));
+    }
+
+    __m256i bad = zero;
+    while (true)
+    {
+        __m256i changed = zero;
+
+        // naked singles: remove the values of solved cells from their peers,
+        // a value solved twice in a unit shows up in twice
+        __m256i single[9];
+        Count col{zero, zero};
+        for (int r = 0; r < 9; ++r)
+        {
+            __m256i isSingle = _mm256_andnot_si256(_mm256_cmpeq_epi16(rows[r], zero),
+                                                   _mm256_cmpeq_epi16(_mm256_and_si256(rows[r], _mm256_sub_epi16(rows[r], one)), zero));
+            single[r] = _mm256_and_si256(rows[r], isSingle);
+            add(col, single[r], zero);
+        }
+        bad = _mm256_or_si256(bad, col.twice);
+
+        for (int band = 0; band < 9; band += 3)
+        {
+            Count bandCount{zero, zero};
+            for (int r = band; r < band + 3; ++r)
+            {
+                add(bandCount, single[r], zero);
+            }
+            Count block = blockCount(bandCount);
+            bad = _mm256_or_si256(bad, block.twice);
+
+            for (int r = band; r < band + 3; ++r)
+            {
+                Count row = rowCount(single[r]);
+                bad = _mm256_or_si256(bad, row.twice);
+
+                __m256i remove = _mm256_or_si256(row.once, _mm256_or_si256(col.once, block.once));
+                __m256i reduced = _mm256_or_si256(_mm256_andnot_si256(remove, rows[r]), single[r]);
+                changed = _mm256_or_si256(changed, _mm256_xor_si256(reduced, rows[r]));
+                rows[r] = reduced;
+            }
+        }
+
+        // hidden singles: values with exactly one position in a unit, every value needs at least one
+        col = {zero, zero};
+        for (int r = 0; r < 9; ++r)
+        {
+            add(col, rows[r], zero);
+        }
+        bad = _mm256_or_si256(bad, _mm256_andnot_si256(col.once, all));
+        __m256i colExact = _mm256_andnot_si256(col.twice, col.once);
+
+        for (int band = 0; band < 9; band += 3)
+        {
+            Count bandCount{zero, zero};
+            for (int r = band; r < band + 3; ++r)
+            {
+                add(bandCount, rows[r], zero);
+            }
+            Count block = blockCount(bandCount);
+            bad = _mm256_or_si256(bad, _mm256_andnot_si256(block.once, all));
+            __m256i blockExact = _mm256_andnot_si256(block.twice, block.once);
+
+            for (int r = band; r < band + 3; ++r)
+            {
+                Count row = rowCount(rows[r]);
+                bad = _mm256_or_si256(bad, _mm256_andnot_si256(row.once, all));
+                __m256i rowExact = _mm256_andnot_si256(row.twice, row.once);
+
+                __m256i hidden = _mm256_and_si256(rows[r], _mm256_or_si256(rowExact, _mm256_or_si256(colExact, blockExact)));
+                // two hidden values in one cell
+                bad = _mm256_or_si256(bad, _mm256_and_si256(hidden, _mm256_sub_epi16(hidden, one)));
+
+                __m256i reduced = _mm256_blendv_epi8(hidden, rows[r], _mm256_cmpeq_epi16(hidden, zero));
+                changed = _mm256_or_si256(changed, _mm256_xor_si256(reduced, rows[r]));
+                rows[r] = reduced;
+
+                // cell without candidates
+                bad = _mm256_or_si256(bad, _mm256_and_si256(_mm256_cmpeq_epi16(rows[r], zero), all));
+            }
+        }
+
+        if (!_mm256_testz_si256(bad, bad))
+        {
+            return false;
+        }
+
+        if (_mm256_testz_si256(changed, changed))
+        {
+            break;
+        }
+    }
+
+    for (int r = 0; r < 9; ++r)
+    {
+        _mm256_store_si256(reinterpret_cast<__m256i*>(grid[r]), rows[r]);
+        std::memcpy(candidates + 9 * r, grid[r], 9 * sizeof(uint16_t));
+    }
+
+    return true;
+}
+
+AVX2_TARGET uint32_t propagateBatchAvx2(uint16_t* candidates)
+{
+    using Geometry = FieldGeometry<9>;
+
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi16(1);
+    const __m256i all = _mm256_set1_epi16(0x1FF);
+
+    __m256i cells[Geometry::NumCells];
+    for (size_t c = 0; c < Geometry::NumCells; ++c)
+    {
+        cells[c] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(candidates + 16 * c));
+    }
+
+    __m256i bad = zero;
+    Count units[Geometry::NumUnits];
+    while (true)
+    {
+        __m256i changed = zero;
+
+        // naked singles, see propagateAvx2
+        __m256i single[Geometry::NumCells];
+        for (size_t c = 0; c < Geometry::NumCells; ++c)
+        {
+            __m256i isSingle = _mm256_andnot_si256(_mm256_cmpeq_epi16(cells[c], zero),
+                                                   _mm256_cmpeq_epi16(_mm256_and_si256(cells[c], _mm256_sub_epi16(cells[c], one)), zero));
+            single[c] = _mm256_and_si256(cells[c], isSingle);
+        }
+
+        for (size_t u = 0; u < Geometry::NumUnits; ++u)
+        {
+            units[u] = {zero, zero};
+            for (auto c : Geometry::units[u])
+            {
+                add(units[u], single[c], zero);
+            }
+            bad = _mm256_or_si256(bad, units[u].twice);
+        }
+
+        for (size_t c = 0; c < Geometry::NumCells; ++c)
+        {
+            const auto& cu = Geometry::cellUnits[c];
+            __m256i remove = _mm256_or_si256(units[cu[0]].once, _mm256_or_si256(units[cu[1]].once, units[cu[2]].once));
+            __m256i reduced = _mm256_or_si256(_mm256_andnot_si256(remove, cells[c]), single[c]);
+            changed = _mm256_or_si256(changed, _mm256_xor_si256(reduced, cells[c]));
+            cells[c] = reduced;
+        }
+
+        // hidden singles
+        for (size_t u = 0; u < Geometry::NumUnits; ++u)
+        {
+            units[u] = {zero, zero};
+            for (auto c : Geometry::units[u])
+            {
+                add(units[u], cells[c], zero);
+            }
+            bad = _mm256_or_si256(bad, _mm256_andnot_si256(units[u].once, all));
+            units[u].once = _mm256_andnot_si256(units[u].twice, units[u].once);
+        }
+
+        for (size_t c = 0; c < Geometry::NumCells; ++c)
+        {
+            const auto& cu = Geometry::cellUnits[c];
+            __m256i exact = _mm256_or_si256(units[cu[0]].once, _mm256_or_si256(units[cu[1]].once, units[cu[2]].once));
+            __m256i hidden = _mm256_and_si256(cells[c], exact);
+            bad = _mm256_or_si256(bad, _mm256_and_si256(hidden, _mm256_sub_epi16(hidden, one)));
+
+            __m256i reduced = _mm256_blendv_epi8(hidden, cells[c], _mm256_cmpeq_epi16(hidden, zero));
+            changed = _mm256_or_si256(changed, _mm256_xor_si256(reduced, cells[c]));
+            cells[c] = reduced;
+
+            bad = _mm256_or_si256(bad, _mm256_cmpeq_epi16(cells[c], zero));
+        }
+
+        // grids are done at different times, the batch runs until the last one is
+        if (_mm256_testz_si256(changed, changed))
+        {
+            break;
+        }
+    }
+
+    for (size_t c = 0; c < Geometry::NumCells; ++c)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(candidates + 16 * c), cells[c]);
+    }
+
+    // two mask bits per 16 bit lane
+    uint32_t valid = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi16(bad, zero)));
+    uint32_t invalid = 0;
+    for (size_t g = 0; g < 16; ++g)
+    {
+        if (!(valid & (1u << (2 * g))))
+            invalid |= 1u << g;
+    }
+    return invalid;
+}
+}
+
+#endif
+
+bool SudokuSimd::supported()
+{
+#if defined(SUDOKU_SIMD_X86) && defined(_MSC_VER)
+    static const bool avx2 = []
+    {
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return false;
+
+        // the OS has to save the ymm registers
+        __cpuid(info, 1);
+        bool osxsave = (info[2] & (1 << 27)) && (info[2] & (1 << 28));
+        if (!osxsave || (_xgetbv(0) & 6) != 6)
+            return false;
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+    }();
+    return avx2;
+#elif defined(SUDOKU_SIMD_X86)
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+#else
+    return false;
+#endif
+}
+
+bool SudokuSimd::propagate9(uint16_t* candidates)
+{
+#ifdef SUDOKU_SIMD_X86
+    if (supported())
+    {
+        return propagateAvx2(candidates);
+    }
+#endif
+    (void)candidates;
+    throw std::runtime_error("SIMD propagation is not supported on this CPU");
+}
+
+uint32_t SudokuSimd::propagateBatch9(uint16_t* candidates)
+{
+#ifdef SUDOKU_SIMD_X86
+    if (supported())
+    {
+        return propagateBatchAvx2(candidates);
+    }
+#endif
+    (void)candidates;
+    throw std::runtime_error("SIMD propagation is not supported on this CPU");
+}
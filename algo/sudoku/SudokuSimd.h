@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Vectorized constraint propagation for 9x9 sudokus.
+ *
+ * A single grid is held as 16 bit lanes of nine AVX2 registers, one per row, and rows, columns
+ * and blocks are reduced with lane shuffles. Batches hold one grid per lane instead.
+ * Either way a whole pass over the grid runs without per cell branches.
+ */
+namespace SudokuSimd
+{
+/**
+ * @return true if the CPU and the build support the AVX2 code path, checked once at runtime
+ */
+bool supported();
+
+/**
+ * @brief propagate9 apply naked and hidden singles until nothing changes anymore
+ * @param candidates row major 9x9 grid of candidate masks, bit (value - 1) is set if the value
+ *        is possible, solved cells hold the single bit of their value. Reduced in place.
+ * @return false if the grid contradicts itself (empty cell, value twice or missing in a unit),
+ *         \a candidates is undefined in this case
+ */
+bool propagate9(uint16_t* candidates);
+
+/// number of grids propagateBatch9() works on at once, one per 16 bit lane
+constexpr size_t BatchSize = 16;
+
+/**
+ * @brief propagateBatch9 propagate9() for BatchSize grids in lockstep
+ *
+ * The masks are stored as structure of arrays, every vector holds one cell of all grids,
+ * so rows, columns and blocks are plain lane wise operations over the cells of the unit.
+ * @param candidates cell major masks, candidates[BatchSize * cell + grid]. Reduced in place.
+ * @return bit g is set if grid g contradicts itself
+ */
+uint32_t propagateBatch9(uint16_t* candidates);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <format>
+#include <iostream>
+#include <utility>
+
+/**
+ * Highest recursion depth of the solver tree output that is compiled in.
+ * Release builds (NDEBUG) default to 0, which removes every trace branch and format string
+ * from the search, debug builds trace up to the runtime level of Sudoku::setLogLevel().
+ * Override with -DSUDOKU_TRACE_LEVEL=<depth>.
+ */
+#ifndef SUDOKU_TRACE_LEVEL
+#ifdef NDEBUG
+#define SUDOKU_TRACE_LEVEL 0
+#else
+#define SUDOKU_TRACE_LEVEL 64
+#endif
+#endif
+
+void printIndent(int recursionDepth);
+
+namespace SudokuTrace
+{
+
+constexpr int MaxLevel = SUDOKU_TRACE_LEVEL;
+
+/**
+ * @brief enabled whether the search node at \a recursionDepth is traced with runtime level \a logLevel
+ *
+ * Constant false if tracing is compiled out, the call sites are dropped with it.
+ */
+inline bool enabled(int logLevel, int recursionDepth)
+{
+    if constexpr (MaxLevel <= 0)
+    {
+        return false;
+    }
+    else
+    {
+        return recursionDepth < logLevel && recursionDepth < MaxLevel;
+    }
+}
+
+/**
+ * @brief line print one indented line of the solver tree, only call after enabled()
+ */
+template<typename... Args>
+void line(int recursionDepth, std::format_string<Args...> fmt, Args&&... args)
+{
+    if constexpr (MaxLevel > 0)
+    {
+        printIndent(recursionDepth);
+        std::cout << std::format(fmt, std::forward<Args>(args)...) << std::endl;
+    }
+}
+
+}
@@ -1,6 +1,7 @@
 #include "TemplateMatch.h"
 
 #include <opencv2/opencv.hpp>
+#include <algorithm>
 #include <vector>
 
 TemplateMatch::TemplateMatch(const OCR& ocr) : Algorithm("TemplateMatch"),
@@ -12,16 +13,20 @@ TemplateMatch::TemplateMatch(const OCR& ocr) : Algorithm("TemplateMatch"),
 
 
     ContainerSpecification out_deb("out_debug", ContainerSpecification::REFERENCE);
+    ContainerSpecification out_alt("out_alternatives", ContainerSpecification::REFERENCE, ContainerSpecification::GENERIC, true);
 
     m_argumentsSpecification.push_back(in_image);
     m_argumentsSpecification.push_back(out_numbers);
     m_argumentsSpecification.push_back(out_rot);
 
     m_argumentsSpecification.push_back(out_deb);
+    m_argumentsSpecification.push_back(out_alt);
 
     m_settings.add(Option("templateDiscardFactor", OptionValue<double>(0.5, 0.5, 0.0, 1.0)));
     m_settings.add(Option("ratioDiscardFactor", OptionValue<double>(1.0, 1.0, 0.0, 1.0)));
     m_settings.add(Option("cellMargin", OptionValue<double>(0.05, 0.05, 0.0, 0.4)));
+    // best digits with their scores per cell in out_alternatives, used by the OCR tolerant solve of Sudoku
+    m_settings.add(Option("alternatives", OptionValue<int>(3, 3, 1, 9)));
 }
 
 TemplateMatch::~TemplateMatch()
@@ -60,22 +65,23 @@ bool TemplateMatch::exec()
         auto outNumbers = std::make_shared<cv::Mat>();
 
         auto outDebug = std::make_shared<cv::Mat>();
+        auto outAlternatives = std::make_shared<cv::Mat>();
         Rotation rot = Rotation::Zero;
         if (!inImage.empty())
         {
             if (m_activeImpl == CPU)
             {
-                matchCPU(inImage, *outNumbers, rot, *outDebug);
+                matchCPU(inImage, *outNumbers, rot, *outDebug, *outAlternatives);
                 m_arguments[3]->add(outDebug);
             }
             else if (m_activeImpl == GPU)
             {
-                matchGPU(inImage, *outNumbers, rot, *outDebug);
+                matchGPU(inImage, *outNumbers, rot, *outDebug, *outAlternatives);
                 m_arguments[3]->add(outDebug);
             }
             else if (m_activeImpl == OPENCV_GPU)
             {
-                matchOCVGPU(inImage, *outNumbers, rot);
+                matchOCVGPU(inImage, *outNumbers, rot, *outAlternatives);
             }
             else
             {
@@ -85,6 +91,12 @@ bool TemplateMatch::exec()
 
         m_arguments[1]->add(outNumbers);
         rotations.push_back(static_cast<int>(rot));
+
+        // optional, empty for an empty input image
+        if (m_arguments.size() > 4)
+        {
+            m_arguments[4]->add(outAlternatives);
+        }
     }
 
     cv::Mat(rotations).copyTo(*m_arguments[2]->get());
@@ -92,6 +104,22 @@ bool TemplateMatch::exec()
     return true;
 }
 
+void TemplateMatch::alternativesMat(std::vector<std::vector<std::pair<int, double>>>& cellScores, cv::Mat& outAlternatives)
+{
+    const int k = m_settings.get("alternatives").valueInt().value();
+    outAlternatives = cv::Mat(static_cast<int>(cellScores.size()), k, CV_64FC2, cv::Scalar(-1.0, 0.0));
+    for (int cell = 0; cell < outAlternatives.rows; ++cell)
+    {
+        auto& scores = cellScores[cell];
+        std::sort(scores.begin(), scores.end(),
+                  [](const std::pair<int, double>& a, const std::pair<int, double>& b) { return a.second > b.second; });
+        for (int a = 0; a < k && a < static_cast<int>(scores.size()); ++a)
+        {
+            outAlternatives.at<cv::Vec2d>(cell, a) = cv::Vec2d(scores[a].first, scores[a].second);
+        }
+    }
+}
+
 void cellImage(cv::Mat& in, cv::Mat& out, double dist, double size, double margin)
 {
     int nSize = size;
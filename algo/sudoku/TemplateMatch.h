@@ -33,9 +33,15 @@ private:
     void _matchTemplateGPU();
 
 private:
-    void matchOCVGPU(cv::Mat inSingle, cv::Mat& outNumbers, Rotation& outRot);
-    void matchCPU(cv::Mat inSingle, cv::Mat& outNumbers, Rotation& outRot, cv::Mat& outDebug);
-    void matchGPU(cv::Mat inSingle, cv::Mat& outNumbers, Rotation& outRot, cv::Mat& outDebug);
+    void matchOCVGPU(cv::Mat inSingle, cv::Mat& outNumbers, Rotation& outRot, cv::Mat& outAlternatives);
+    void matchCPU(cv::Mat inSingle, cv::Mat& outNumbers, Rotation& outRot, cv::Mat& outDebug, cv::Mat& outAlternatives);
+    void matchGPU(cv::Mat inSingle, cv::Mat& outNumbers, Rotation& outRot, cv::Mat& outDebug, cv::Mat& outAlternatives);
+
+    /**
+     * @brief alternativesMat top "alternatives" (digit, score) pairs of each cell, best first, one row per cell,
+     *        unused entries are (-1, 0)
+     */
+    void alternativesMat(std::vector<std::vector<std::pair<int, double>>>& cellScores, cv::Mat& outAlternatives);
 
 public: // IComputeTask
     bool InitResources(cl_device_id Device, cl_context Context, cl_command_queue CommandQueue) override;
@@ -135,7 +135,7 @@ void matchTemplateCPU(cv::Mat& img, cv::Mat& templt, cv::Mat& outResult, cv::Tem
     }
 }
 
-void TemplateMatch::matchCPU(cv::Mat image, cv::Mat &outNumbers, Rotation &outRot, cv::Mat &outDebug)
+void TemplateMatch::matchCPU(cv::Mat image, cv::Mat &outNumbers, Rotation &outRot, cv::Mat &outDebug, cv::Mat& outAlternatives)
 {
     double cm = m_settings.get("cellMargin").valueDouble().value();
 
@@ -180,6 +180,7 @@ void TemplateMatch::matchCPU(cv::Mat image, cv::Mat &outNumbers, Rotation &outRo
     t.restart();
     cv::Mat guesses = cv::Mat::zeros(9, 9, CV_8U);
     cv::Mat guessScores = cv::Mat::zeros(9, 9, CV_64F);
+    std::vector<std::vector<std::pair<int, double>>> cellScores(9 * 9);
     for (int d = 0; d < digits[0].size(); ++d)
     {
 
@@ -191,6 +192,7 @@ void TemplateMatch::matchCPU(cv::Mat image, cv::Mat &outNumbers, Rotation &outRo
         double max;
         cv::minMaxLoc(res[d].rowRange(i*rSizeY, (i+1)*rSizeY).colRange(j*rSizeX, (j+1)*rSizeX),
                       nullptr, &max, nullptr, nullptr);
+        cellScores[i * 9 + j].push_back(std::pair<int, double>(digits[0][d].value, max));
         double m = guessScores.at<double>(i, j);
         if (max > m)
         {
@@ -203,6 +205,8 @@ void TemplateMatch::matchCPU(cv::Mat image, cv::Mat &outNumbers, Rotation &outRo
     std::cout << "maxloc " << t.elapsed() << " ms"
               << std::endl << guesses << std::endl << guessScores << std::endl;
 
+    alternativesMat(cellScores, outAlternatives);
+
 
 
     cv::Mat r = res[0].getMat(cv::ACCESS_READ);
@@ -22,7 +22,7 @@ bool TemplateMatch::InitResources(cl_device_id Device, cl_context Context, cl_co
 
     cl_int clError;
 
-    m_program = CLUtil::compileProgram(Device, Context, Utils::loadFile("algo/sudoku/TemplateMatch.cl"));
+    m_program = CLUtil::cachedProgram(Device, Context, Utils::loadFile("algo/sudoku/TemplateMatch.cl"));
     if(m_program == nullptr) return false;
 
     //create kernels
@@ -348,7 +348,7 @@ std::vector<std::pair<int, double>>
     return guesses;
 }
 
-void TemplateMatch::matchGPU(cv::Mat image, cv::Mat &outNumbers, Rotation& outRot, cv::Mat &outDebug)
+void TemplateMatch::matchGPU(cv::Mat image, cv::Mat &outNumbers, Rotation& outRot, cv::Mat &outDebug, cv::Mat& outAlternatives)
 {
     double cm = m_settings.get("cellMargin").valueDouble().value();
 
@@ -393,6 +393,7 @@ void TemplateMatch::matchGPU(cv::Mat image, cv::Mat &outNumbers, Rotation& outRo
     t.restart();
     cv::Mat guesses = cv::Mat::zeros(9, 9, CV_8U);
     cv::Mat guessScores = cv::Mat::zeros(9, 9, CV_64F);
+    std::vector<std::vector<std::pair<int, double>>> cellScores(9 * 9);
     for (int d = 0; d < digits[0].size(); ++d)
     {
 
@@ -404,6 +405,7 @@ void TemplateMatch::matchGPU(cv::Mat image, cv::Mat &outNumbers, Rotation& outRo
         double max;
         cv::minMaxLoc(res[d].rowRange(i*rSizeY, (i+1)*rSizeY).colRange(j*rSizeX, (j+1)*rSizeX),
                       nullptr, &max, nullptr, nullptr);
+        cellScores[i * 9 + j].push_back(std::pair<int, double>(digits[0][d].value, max));
         double m = guessScores.at<double>(i, j);
         if (max > m)
         {
@@ -416,6 +418,8 @@ void TemplateMatch::matchGPU(cv::Mat image, cv::Mat &outNumbers, Rotation& outRo
     std::cout << "maxloc " << t.elapsed() << " ms"
               << std::endl << guesses << std::endl << guessScores << std::endl;
 
+    alternativesMat(cellScores, outAlternatives);
+
 
 
     cv::Mat r = res[0].getMat(cv::ACCESS_READ);
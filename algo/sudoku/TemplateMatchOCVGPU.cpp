@@ -9,7 +9,7 @@
 bool matchSingleDigit(cv::Mat& img, int row, int col,
                       double dist, double size, double margin,
                       const std::vector<Digit>& digits, double ratioDiscardFactor,
-                      int& outDigit, double& outScoreDigit)
+                      int& outDigit, double& outScoreDigit, std::vector<std::pair<int, double>>& outAlternatives)
 {
     int left = col * dist + margin;
     int top =  row * dist + margin;
@@ -23,6 +23,7 @@ bool matchSingleDigit(cv::Mat& img, int row, int col,
     std::vector<double> scores;
     double maxScore = 0.f;
     int maxScoreDigit = -1;
+    outAlternatives.clear();
 
     for (const Digit& d : digits)
     {
@@ -40,6 +41,7 @@ bool matchSingleDigit(cv::Mat& img, int row, int col,
         cv::minMaxLoc(res, nullptr, &max, nullptr, nullptr);
 
         scores.push_back(max);
+        outAlternatives.push_back(std::pair<int, double>(d.value, max));
         if (max > maxScore)
         {
             maxScore = max;
@@ -65,9 +67,11 @@ bool matchSingleDigit(cv::Mat& img, int row, int col,
 }
 
 std::vector<std::pair<int, double>> matchDirection(cv::Mat& img, double dist, double size, double margin, const std::vector<Digit>& digits,
-                                                   double templateDiscardFactor, double ratioDiscardFactor, double& outAvgScore)
+                                                   double templateDiscardFactor, double ratioDiscardFactor, double& outAvgScore,
+                                                   std::vector<std::vector<std::pair<int, double>>>& outAlternatives)
 {
     std::vector<std::pair<int, double>> guesses;
+    outAlternatives.assign(9 * 9, {});
 
     double maxOverallScore = 0.;
     outAvgScore = 0.;
@@ -80,7 +84,7 @@ std::vector<std::pair<int, double>> matchDirection(cv::Mat& img, double dist, do
             int digit;
             bool ok = matchSingleDigit(img, row, col,
                                        dist, size, margin,
-                                       digits, ratioDiscardFactor, digit, scoreDigit);
+                                       digits, ratioDiscardFactor, digit, scoreDigit, outAlternatives[row * 9 + col]);
 
             /*
             double avg = 0., variance = 0.;
@@ -118,7 +122,7 @@ std::vector<std::pair<int, double>> matchDirection(cv::Mat& img, double dist, do
     return guesses;
 }
 
-void TemplateMatch::matchOCVGPU(cv::Mat image, cv::Mat &outNumbers, Rotation &outRot)
+void TemplateMatch::matchOCVGPU(cv::Mat image, cv::Mat &outNumbers, Rotation &outRot, cv::Mat& outAlternatives)
 {
     double cm = m_settings.get("cellMargin").valueDouble().value();
     double dist = image.rows / 9.0;
@@ -137,10 +141,11 @@ void TemplateMatch::matchOCVGPU(cv::Mat image, cv::Mat &outNumbers, Rotation &ou
     std::vector<std::vector<std::pair<int, double>>> directionGuesses;
 
     std::vector<double> avgScore(4);
-    directionGuesses.push_back(matchDirection(image, dist, size, margin, digits[0], templateDF, ratioDF, avgScore[0]));
-    directionGuesses.push_back(matchDirection(image, dist, size, margin, digits[1], templateDF, ratioDF, avgScore[1]));
-    directionGuesses.push_back(matchDirection(image, dist, size, margin, digits[2], templateDF, ratioDF, avgScore[2]));
-    directionGuesses.push_back(matchDirection(image, dist, size, margin, digits[3], templateDF, ratioDF, avgScore[3]));
+    std::vector<std::vector<std::pair<int, double>>> directionAlternatives[4];
+    directionGuesses.push_back(matchDirection(image, dist, size, margin, digits[0], templateDF, ratioDF, avgScore[0], directionAlternatives[0]));
+    directionGuesses.push_back(matchDirection(image, dist, size, margin, digits[1], templateDF, ratioDF, avgScore[1], directionAlternatives[1]));
+    directionGuesses.push_back(matchDirection(image, dist, size, margin, digits[2], templateDF, ratioDF, avgScore[2], directionAlternatives[2]));
+    directionGuesses.push_back(matchDirection(image, dist, size, margin, digits[3], templateDF, ratioDF, avgScore[3], directionAlternatives[3]));
 
     for (int i = 0; i < 4; ++i)
     {
@@ -166,4 +171,7 @@ void TemplateMatch::matchOCVGPU(cv::Mat image, cv::Mat &outNumbers, Rotation &ou
     }
 
     cv::Mat(numbers).copyTo(outNumbers);
+
+    // rows in the order of outNumbers, a discarded cell keeps its alternatives
+    alternativesMat(directionAlternatives[bestDirection], outAlternatives);
 }
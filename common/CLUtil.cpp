@@ -3,6 +3,9 @@
 #include "IComputeTask.h"
 
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <tuple>
 #include <vector>
 
 namespace CLUtil
@@ -44,6 +47,58 @@ cl_program compileProgram(cl_device_id device, cl_context context,
 	return prog;
 }
 
+namespace
+{
+using ProgramKey = std::tuple<cl_device_id, cl_context, std::string, std::string>;
+
+std::map<ProgramKey, cl_program> programCache;
+std::mutex programCacheMutex;
+}
+
+cl_program cachedProgram(cl_device_id device, cl_context context,
+                         const std::string& sourceCode, const std::string& options)
+{
+	std::lock_guard lock(programCacheMutex);
+
+	ProgramKey key(device, context, sourceCode, options);
+	auto it = programCache.find(key);
+	if (it == programCache.end())
+	{
+		// a failed build is not cached, the next call tries again
+		cl_program prog = compileProgram(device, context, sourceCode, options);
+		if (!prog)
+		{
+			return nullptr;
+		}
+
+		// the context must not go away while its pointer is a key
+		clRetainContext(context);
+		it = programCache.emplace(std::move(key), prog).first;
+	}
+
+	clRetainProgram(it->second);
+	return it->second;
+}
+
+void releaseCachedPrograms(cl_context context)
+{
+	std::lock_guard lock(programCacheMutex);
+
+	for (auto it = programCache.begin(); it != programCache.end();)
+	{
+		if (std::get<1>(it->first) == context)
+		{
+			clReleaseProgram(it->second);
+			clReleaseContext(context);
+			it = programCache.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
 void printBuildLog(cl_program program, cl_device_id device)
 {
 	cl_build_status buildStatus;
@@ -159,6 +214,7 @@ CLHandler::~CLHandler()
 
     if (m_CLContext != nullptr)
     {
+		releaseCachedPrograms(m_CLContext);
         clReleaseContext(m_CLContext);
         m_CLContext = nullptr;
     }
@@ -18,6 +18,22 @@ namespace CLUtil
 cl_program compileProgram(cl_device_id device, cl_context context,
                           const std::string& sourceCode, const std::string& options = "");
 
+/**
+ * @brief cachedProgram compileProgram() that builds every combination of device, context, source and options once
+ *
+ * The cache keeps a reference to the program and its context until releaseCachedPrograms() is called for it.
+ * @return a new reference to the program, released with clReleaseProgram() as usual,
+ *         nullptr if it could not be built (failures are not cached)
+ */
+cl_program cachedProgram(cl_device_id device, cl_context context,
+                         const std::string& sourceCode, const std::string& options = "");
+
+/**
+ * @brief releaseCachedPrograms drop the cached programs of \a context and the references to it,
+ *        called by CLHandler before it releases its context
+ */
+void releaseCachedPrograms(cl_context context);
+
 void printBuildLog(cl_program program, cl_device_id device);
 
 /**
@@ -0,0 +1,238 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace
+{
+thread_local const ThreadPool* t_pool = nullptr;
+thread_local int t_worker = -1;
+}
+
+ThreadPool::TaskGroup::TaskGroup(ThreadPool& pool) : m_pool(pool), m_pending(0), m_cancelled(false)
+{
+
+}
+
+ThreadPool::TaskGroup::~TaskGroup()
+{
+    // tasks reference this group, never leave before they are done
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this]{ return m_pending == 0; });
+}
+
+void ThreadPool::TaskGroup::run(std::function<void()> task)
+{
+    ++m_pending;
+    m_pool.push({std::move(task), this});
+}
+
+void ThreadPool::TaskGroup::wait()
+{
+    int worker = m_pool.currentWorker();
+    if (worker >= 0)
+    {
+        // help out instead of blocking a worker
+        Task task;
+        while (m_pending > 0)
+        {
+            if (m_pool.pop(worker, task))
+            {
+                m_pool.execute(task);
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this]{ return m_pending == 0; });
+
+    if (m_error)
+    {
+        std::exception_ptr error = m_error;
+        m_error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::TaskGroup::finished(std::exception_ptr error)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (error && !m_error)
+    {
+        m_error = error;
+        m_cancelled = true;
+    }
+    if (--m_pending == 0)
+    {
+        m_done.notify_all();
+    }
+}
+
+ThreadPool::ThreadPool(size_t numThreads) : m_queued(0), m_nextQueue(0), m_stop(false)
+{
+    if (numThreads == 0)
+    {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (size_t i = 0; i < numThreads; ++i)
+    {
+        m_queues.push_back(std::make_unique<Queue>());
+    }
+
+    for (size_t i = 0; i < numThreads; ++i)
+    {
+        m_threads.emplace_back(&ThreadPool::run, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+
+    for (auto& t : m_threads)
+    {
+        t.join();
+    }
+}
+
+int ThreadPool::currentWorker() const
+{
+    return t_pool == this ? t_worker : -1;
+}
+
+void ThreadPool::push(Task task)
+{
+    int worker = currentWorker();
+    size_t index = worker >= 0 ? static_cast<size_t>(worker) : m_nextQueue++ % m_queues.size();
+
+    {
+        std::lock_guard<std::mutex> lock(m_queues[index]->mutex);
+        m_queues[index]->tasks.push_back(std::move(task));
+    }
+
+    ++m_queued;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+    }
+    m_wake.notify_one();
+}
+
+bool ThreadPool::pop(size_t worker, Task& outTask)
+{
+    if (m_queued == 0)
+    {
+        return false;
+    }
+
+    // newest task of the own deque first
+    {
+        Queue& own = *m_queues[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty())
+        {
+            outTask = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            --m_queued;
+            return true;
+        }
+    }
+
+    // steal the oldest task of another worker, it is the largest subproblem
+    for (size_t i = 1; i < m_queues.size(); ++i)
+    {
+        Queue& victim = *m_queues[(worker + i) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            outTask = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            --m_queued;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::execute(Task& task)
+{
+    std::exception_ptr error;
+    if (!task.group->cancelled())
+    {
+        try
+        {
+            task.func();
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+    }
+
+    // release captured state before the group can be destroyed
+    task.func = nullptr;
+    task.group->finished(error);
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t, size_t)>& func, size_t grain)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    grain = std::max<size_t>(grain, 1);
+    std::atomic<size_t> next = 0;
+
+    TaskGroup group(*this);
+    size_t numTasks = std::min(size(), (count + grain - 1) / grain);
+    for (size_t t = 0; t < numTasks; ++t)
+    {
+        group.run([&]
+        {
+            size_t worker = static_cast<size_t>(currentWorker());
+            size_t begin;
+            while (!group.cancelled() && (begin = next.fetch_add(grain)) < count)
+            {
+                size_t end = std::min(begin + grain, count);
+                for (size_t i = begin; i < end; ++i)
+                {
+                    func(i, worker);
+                }
+            }
+        });
+    }
+
+    group.wait();
+}
+
+void ThreadPool::run(size_t worker)
+{
+    t_pool = this;
+    t_worker = static_cast<int>(worker);
+
+    Task task;
+    while (true)
+    {
+        if (pop(worker, task))
+        {
+            execute(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_wake.wait(lock, [this]{ return m_stop || m_queued > 0; });
+        if (m_stop)
+        {
+            return;
+        }
+    }
+}
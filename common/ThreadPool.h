@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief ThreadPool fixed set of worker threads, started once and reused for every job
+ *
+ * Every worker owns a task deque. Tasks submitted from a worker go to the back of its own deque
+ * and are taken from there again (depth first), idle workers steal from the front of the other
+ * deques. Tasks submitted from outside the pool are distributed round robin.
+ */
+class ThreadPool
+{
+public:
+    /**
+     * @brief TaskGroup set of tasks that can be waited for and cancelled together
+     */
+    class TaskGroup
+    {
+    public:
+        TaskGroup(ThreadPool& pool);
+        ~TaskGroup();
+
+        /**
+         * @brief run queue \a task, may be called from inside tasks of this group
+         */
+        void run(std::function<void()> task);
+
+        /**
+         * @brief wait block until all tasks of this group finished, a worker thread executes
+         *        queued tasks meanwhile. Rethrows the first exception thrown by a task.
+         */
+        void wait();
+
+        /**
+         * @brief cancel tasks of this group that did not start yet are skipped,
+         *        running tasks can poll cancelled() to stop early
+         */
+        void cancel() { m_cancelled = true; }
+        bool cancelled() const { return m_cancelled.load(std::memory_order_relaxed); }
+
+    private:
+        friend class ThreadPool;
+
+        void finished(std::exception_ptr error);
+
+    private:
+        ThreadPool& m_pool;
+        std::atomic<size_t> m_pending;
+        std::atomic<bool> m_cancelled;
+
+        std::mutex m_mutex;
+        std::condition_variable m_done;
+        std::exception_ptr m_error;
+    };
+
+public:
+    /**
+     * @param numThreads number of workers, 0 uses std::thread::hardware_concurrency()
+     */
+    explicit ThreadPool(size_t numThreads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return m_threads.size(); }
+
+    /**
+     * @return index of the calling worker of this pool, -1 if called from another thread
+     */
+    int currentWorker() const;
+
+    /**
+     * @brief parallelFor call \a func(index, worker) for every index in [0, count) and wait for completion
+     *
+     * Indices are handed out in chunks of \a grain from a shared counter, \a worker is in [0, size())
+     * and can be used to address per thread scratch data. The first exception thrown by \a func
+     * is rethrown in the calling thread.
+     */
+    void parallelFor(size_t count, const std::function<void(size_t, size_t)>& func, size_t grain = 1);
+
+private:
+    struct Task
+    {
+        std::function<void()> func;
+        TaskGroup* group;
+    };
+
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void push(Task task);
+    bool pop(size_t worker, Task& outTask);
+    void execute(Task& task);
+
+    void run(size_t worker);
+
+private:
+    std::vector<std::thread> m_threads;
+    std::vector<std::unique_ptr<Queue>> m_queues;
+
+    std::atomic<size_t> m_queued;
+    std::atomic<size_t> m_nextQueue;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stop;
+};
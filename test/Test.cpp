@@ -1,10 +1,18 @@
 #include "Test.h"
 
 #include <CLUtil.h>
+#include <Timer.h>
 #include <sudoku/Sudoku.h>
+#include <sudoku/PuzzleIO.h>
+#include <sudoku/SolutionCache.h>
 
+#include <algorithm>
+#include <cmath>
+#include <fstream>
 #include <string>
 #include <iostream>
+#include <stop_token>
+#include <vector>
 
 #include <opencv2/opencv.hpp>
 
@@ -26,6 +34,65 @@ bool openInputData(std::string file, std::string element, cv::Mat& out)
     return false;
 }
 
+/// appends the puzzles of a line file to \a out, one 9x9 puzzle per line, '.' or '0' for empty cells
+bool openPuzzleLines(std::string file, std::vector<int>& out)
+{
+    std::ifstream in(file);
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.size() != 81 || line[0] == '#')
+            continue;
+
+        for (char c : line)
+            out.push_back(c >= '1' && c <= '9' ? c - '0' : 0);
+    }
+
+    if (out.empty())
+    {
+        cout << "Error opening evaluation data file! (" << file << ")" << endl;
+        return false;
+    }
+    return true;
+}
+
+/// true if \a result is a filled NxN board without repeated values that keeps the givens of \a grid
+bool isSolution(const int* grid, const int* result, size_t N)
+{
+    const size_t box = static_cast<size_t>(std::sqrt(double(N)));
+    for (size_t i = 0; i < N * N; ++i)
+    {
+        if (result[i] < 1 || result[i] > int(N) || (grid[i] > 0 && grid[i] != result[i]))
+            return false;
+    }
+
+    for (size_t unit = 0; unit < N; ++unit)
+    {
+        // seen values of the row, the column and the box with this index
+        std::vector<char> seen(3 * (N + 1), 0);
+        for (size_t k = 0; k < N; ++k)
+        {
+            size_t boxCell = (unit / box * box + k / box) * N + unit % box * box + k % box;
+            if (seen[result[unit * N + k]]++ || seen[N + 1 + result[k * N + unit]]++ || seen[2 * (N + 1) + result[boxCell]]++)
+                return false;
+        }
+    }
+    return true;
+}
+
+/// number of the \a count grids whose result is not a solution
+size_t wrongSolutions(const std::vector<int>& grids, const std::vector<int>& results, size_t count, size_t N)
+{
+    size_t wrong = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        wrong += !isSolution(grids.data() + i * N * N, results.data() + i * N * N, N);
+    }
+    return wrong;
+}
+
 bool saveOutputData(std::string file, std::string element, cv::Mat& data, bool image)
 {
     if (image)
@@ -75,6 +142,341 @@ bool TestSolver::DoCompute()
 
     }
 
+    cout << endl << "Running Sudoku batch solver..." << endl << endl;
+    {
+        std::vector<int> puzzles;
+        if (openPuzzleLines("eval/solver/SudokuSolver_9_lines.txt", puzzles))
+        {
+            // the file over and over, so the grids side by side in a batch take different search paths
+            const size_t numPuzzles = puzzles.size() / 81;
+            const size_t count = std::max<size_t>(10000 / numPuzzles, 1) * numPuzzles;
+            std::vector<int> grids, results(count * 81);
+            while (grids.size() < count * 81)
+            {
+                grids.insert(grids.end(), puzzles.begin(), puzzles.end());
+            }
+
+            for (auto impl : {Algorithm::CPU, Algorithm::CPU_EXACT_COVER, Algorithm::CPU_BITBOARD, Algorithm::GPU})
+            {
+                Sudoku s(9);
+                s.setLogLevel(0);
+                s.setImplementation(impl);
+                if (impl == Algorithm::GPU)
+                {
+                    m_context.initTask(s);
+                }
+
+                size_t solved = s.solveBatch(grids.data(), results.data(), count);
+                size_t wrong = wrongSolutions(grids, results, count, 9);
+                cout << (impl == Algorithm::CPU ? "CPU" : impl == Algorithm::GPU ? "GPU"
+                         : impl == Algorithm::CPU_BITBOARD ? "CPU bitboard" : "CPU exact cover")
+                     << ": solved " << solved << " of " << count << " (" << s.throughput() << " grids/s, p99 "
+                     << s.stats().latency.percentile(99.0) << " ms)"
+                     << (wrong ? ", FAILED: " + std::to_string(wrong) + " wrong solutions" : "") << endl;
+            }
+
+            Sudoku s(9);
+            s.setLogLevel(0);
+            s.setImplementation(Algorithm::CPU);
+            s.settings().get("simdPropagation").setBoolValue(false);
+
+            size_t solved = s.solveBatch(grids.data(), results.data(), count);
+            size_t wrong = wrongSolutions(grids, results, count, 9);
+            cout << "CPU scalar propagation: solved " << solved << " of " << count
+                 << " (" << s.throughput() << " grids/s)"
+                 << (wrong ? ", FAILED: " + std::to_string(wrong) + " wrong solutions" : "") << endl;
+        }
+    }
+
+    cout << endl << "Running Sudoku batch solver on puzzle files..." << endl << endl;
+    try
+    {
+        // chunks are read from the mapping, solved and streamed out, so the file never has to fit into memory
+        const size_t chunk = 4096;
+        std::vector<int> grids(chunk * 81), results(chunk * 81);
+
+        Sudoku s(9);
+        s.setLogLevel(0);
+        s.setImplementation(Algorithm::CPU);
+
+        Timer timer;
+        PuzzleReader reader("eval/solver/SudokuSolver_9_lines.txt");
+        PuzzleWriter writer("eval/solver/SudokuSolver_9_lines_Result.txt", 9, PuzzleFormat::Lines);
+        PuzzleWriter packed("eval/solver/SudokuSolver_9_lines.sdk", 9, PuzzleFormat::Packed);
+        size_t count = 0, solved = 0;
+        double solveTime = 0.0;
+        while (size_t n = reader.read(grids.data(), chunk))
+        {
+            packed.write(grids.data(), n);
+
+            Timer solveTimer;
+            solved += s.solveBatch(grids.data(), results.data(), n);
+            solveTime += solveTimer.elapsed();
+
+            writer.write(results.data(), n);
+            count += n;
+        }
+        writer.flush();
+        packed.flush();
+        cout << "lines: solved " << solved << " of " << count << " in " << timer.elapsed() << " ms, "
+             << solveTime << " ms of it solving" << endl;
+
+        timer.restart();
+        PuzzleReader packedReader("eval/solver/SudokuSolver_9_lines.sdk");
+        count = 0;
+        while (size_t n = packedReader.read(grids.data(), chunk))
+        {
+            count += n;
+        }
+        cout << "packed: read " << count << " puzzles in " << timer.elapsed() << " ms" << endl;
+
+        // the packed file has to give back exactly the puzzles of the line file
+        PuzzleReader lineReader("eval/solver/SudokuSolver_9_lines.txt");
+        PuzzleReader packedCheck("eval/solver/SudokuSolver_9_lines.sdk");
+        bool equal = true;
+        size_t n = 0;
+        do
+        {
+            n = lineReader.read(grids.data(), chunk);
+            equal = packedCheck.read(results.data(), chunk) == n && std::equal(grids.begin(), grids.begin() + n * 81, results.begin());
+        } while (equal && n > 0);
+        cout << "packed: " << (equal ? "same puzzles as the line file" : "FAILED, puzzles differ from the line file") << endl;
+    }
+    catch (const std::exception& e)
+    {
+        cout << "Error in puzzle file: " << e.what() << endl;
+    }
+
+    cout << endl << "Comparing Sudoku deduction rules..." << endl << endl;
+    {
+        cv::Mat in;
+        if (openInputData("eval/solver/SudokuSolver_9_1.yml", "field", in))
+        {
+            std::vector<int> grid(in), result(grid.size());
+            for (std::string rule : {"", "nakedPairs", "hiddenPairs", "pointingPairs", "boxLineReduction", "xWing"})
+            {
+                Sudoku s(9);
+                s.setLogLevel(0);
+                s.setImplementation(Algorithm::CPU);
+                if (!rule.empty())
+                {
+                    s.settings().get(rule).setBoolValue(true);
+                }
+
+                Timer timer;
+                size_t solved = s.solveBatch(grid.data(), result.data(), 1);
+                cout << (rule.empty() ? "singles only" : rule) << ": "
+                     << (!solved ? "not solved" : isSolution(grid.data(), result.data(), 9) ? "solved" : "FAILED, wrong solution")
+                     << ", " << s.searchNodes() << " search nodes, " << timer.elapsed() << " ms" << endl;
+            }
+        }
+    }
+
+    cout << endl << "Comparing Sudoku branching heuristics..." << endl << endl;
+    {
+        cv::Mat in;
+        if (openInputData("eval/solver/SudokuSolver_9_1.yml", "field", in))
+        {
+            std::vector<int> grid(in), result(grid.size());
+            // "branchCell" tie-breaks
+            const char* cellNames[] = {"first cell", "most unsolved", "most conflicts"};
+            for (int cell : {0, 1, 2})
+            {
+                for (bool leastConstraining : {false, true})
+                {
+                    Sudoku s(9);
+                    s.setLogLevel(0);
+                    s.setImplementation(Algorithm::CPU);
+                    s.settings().get("branchCell").setIntValue(cell);
+                    s.settings().get("leastConstrainingValue").setBoolValue(leastConstraining);
+
+                    Timer timer;
+                    size_t solved = s.solveBatch(grid.data(), result.data(), 1);
+                    cout << cellNames[cell] << (leastConstraining ? ", least constraining value" : "") << ": "
+                         << (!solved ? "not solved" : isSolution(grid.data(), result.data(), 9) ? "solved" : "FAILED, wrong solution")
+                         << ", " << s.searchNodes() << " search nodes, " << timer.elapsed() << " ms" << endl;
+                }
+            }
+        }
+    }
+
+    cout << endl << "Checking Sudoku uniqueness..." << endl << endl;
+    {
+        cv::Mat in;
+        if (openInputData("eval/solver/SudokuSolver_9_1.yml", "field", in))
+        {
+            std::vector<int> grid(in);
+            Sudoku s(9);
+            s.setLogLevel(0);
+
+            Timer timer;
+            size_t solutions = s.countSolutions(grid.data(), 2);
+            cout << (solutions == 1 ? "unique solution" : solutions == 0 ? "no solution" : "more than one solution")
+                 << ", " << s.searchNodes() << " search nodes, " << timer.elapsed() << " ms" << endl;
+        }
+    }
+
+    cout << endl << "Checking Sudoku solution cache..." << endl << endl;
+    {
+        cv::Mat in;
+        if (openInputData("eval/solver/SudokuSolver_9_1.yml", "field", in))
+        {
+            // the OCR marks empty cells with -1, they must give the same key as 0
+            std::vector<int> grid(in), solution(grid.size()), cached(grid.size());
+            std::replace(grid.begin(), grid.end(), 0, -1);
+
+            Sudoku s(9);
+            s.setLogLevel(0);
+            s.solveBatch(grid.data(), solution.data(), 1);
+
+            for (bool symmetry : {false, true})
+            {
+                SolutionCache cache(9, 16, symmetry);
+                bool first = cache.find(grid.data(), cached.data());
+                cache.insert(grid.data(), solution.data());
+                bool second = cache.find(grid.data(), cached.data());
+                bool ok = !first && second && cached == solution;
+                cout << (symmetry ? "symmetric key" : "plain key") << ": " << (ok ? "hit on the second lookup" : "FAILED")
+                     << " (" << cache.hits() << " hits, " << cache.misses() << " misses)" << endl;
+            }
+        }
+    }
+
+    cout << endl << "Checking Sudoku re-solve..." << endl << endl;
+    {
+        cv::Mat in;
+        if (openInputData("eval/solver/SudokuSolver_9_1.yml", "field", in))
+        {
+            std::vector<int> grid(in), solution(grid.size()), resolved(grid.size());
+            Sudoku s(9);
+            s.setLogLevel(0);
+            s.solveBatch(grid.data(), solution.data(), 1);
+
+            // the first frame has no previous solution, a new given must not read it
+            size_t cell = std::find_if(grid.begin(), grid.end(), [](int v) { return v <= 0; }) - grid.begin();
+            bool success = cell < grid.size() && s.resolve(grid.data(), nullptr, {{cell, solution[cell]}}, resolved.data());
+            success = success && resolved[cell] == solution[cell] && isSolution(grid.data(), resolved.data(), 9);
+            cout << "without previous solution: " << (success ? "solved" : "FAILED") << endl;
+        }
+    }
+
+    cout << endl << "Checking Sudoku budget and cancellation..." << endl << endl;
+    {
+        std::vector<int> grids;
+        if (openPuzzleLines("eval/solver/SudokuSolver_9_lines.txt", grids))
+        {
+            // the first puzzle of the file needs far more than one search node
+            Sudoku s(9);
+            s.setLogLevel(0);
+            s.setImplementation(Algorithm::CPU);
+            s.settings().get("nodeBudget").setIntValue(1);
+
+            auto ci = std::make_shared<Container>(ContainerSpecification("in_grid", ContainerSpecification::READ_ONLY));
+            auto co = std::make_shared<Container>(ContainerSpecification("out_grid", ContainerSpecification::REFERENCE));
+            ci->set(std::make_shared<cv::Mat>(cv::Mat(std::vector<int>(grids.begin(), grids.begin() + 81), true)));
+            co->set(std::make_shared<cv::Mat>());
+            s.addContainer(ci);
+            s.addContainer(co);
+
+            s.exec();
+            bool ok = s.budgetExceeded() && co->get(co->size() - 1)->empty();
+            cout << "node budget of 1: " << (ok ? "unsolved, budget exceeded" : "FAILED") << endl;
+
+            // a stop requested before the batch skips every grid
+            const size_t count = grids.size() / 81;
+            std::vector<int> results(grids.size(), -1);
+            std::stop_source stop;
+            stop.request_stop();
+
+            Sudoku batch(9);
+            batch.setLogLevel(0);
+            batch.setImplementation(Algorithm::CPU);
+            batch.setStopToken(stop.get_token());
+            size_t solved = batch.solveBatch(grids.data(), results.data(), count);
+            ok = solved == 0 && batch.stats().budgetExceeded == count && std::all_of(results.begin(), results.end(), [](int v) { return v == 0; });
+            cout << "stop requested: " << (ok ? "skipped all " + std::to_string(count) + " grids" : "FAILED") << endl;
+        }
+    }
+
+    cout << endl << "Checking Sudoku OCR tolerant solve..." << endl << endl;
+    {
+        cv::Mat in;
+        if (openInputData("eval/solver/SudokuSolver_9_1.yml", "field", in))
+        {
+            // the corrected givens mark empty cells with 0
+            std::vector<int> grid(in), result(grid.size()), corrected(grid.size());
+            std::replace(grid.begin(), grid.end(), -1, 0);
+            Sudoku s(9);
+            s.setLogLevel(0);
+            s.setImplementation(Algorithm::CPU);
+
+            // misread the first given as the digit of another given in its row, the right digit is the runner-up
+            std::vector<int> misread(grid);
+            size_t cell = std::find_if(grid.begin(), grid.end(), [](int v) { return v > 0; }) - grid.begin();
+            for (size_t col = 0; col < 9; ++col)
+            {
+                int value = grid[cell / 9 * 9 + col];
+                if (value > 0 && value != grid[cell])
+                {
+                    misread[cell] = value;
+                    break;
+                }
+            }
+
+            std::vector<Sudoku::Alternatives> alternatives(grid.size());
+            cv::Mat alternativesMat(int(grid.size()), 2, CV_64FC2, cv::Scalar(-1.0, 0.0));
+            for (size_t i = 0; i < grid.size(); ++i)
+            {
+                if (misread[i] > 0)
+                {
+                    alternatives[i] = {{misread[i], 1.0}, {i == cell ? grid[i] : misread[i] % 9 + 1, i == cell ? 0.9 : 0.1}};
+                    alternativesMat.at<cv::Vec2d>(int(i), 0) = cv::Vec2d(alternatives[i][0].value, alternatives[i][0].score);
+                    alternativesMat.at<cv::Vec2d>(int(i), 1) = cv::Vec2d(alternatives[i][1].value, alternatives[i][1].score);
+                }
+            }
+
+            bool ok = misread != grid && s.solveTolerant(misread.data(), alternatives, result.data(), corrected.data())
+                      && isSolution(grid.data(), result.data(), 9) && corrected == grid;
+            cout << "solveTolerant: " << (ok ? "restored the misread given" : "FAILED") << endl;
+
+            // exec() takes the alternatives from its optional third argument
+            auto ci = std::make_shared<Container>(ContainerSpecification("in_grid", ContainerSpecification::READ_ONLY));
+            auto co = std::make_shared<Container>(ContainerSpecification("out_grid", ContainerSpecification::REFERENCE));
+            auto ca = std::make_shared<Container>(ContainerSpecification("in_alternatives", ContainerSpecification::READ_ONLY));
+            ci->set(std::make_shared<cv::Mat>(cv::Mat(misread, true)));
+            co->set(std::make_shared<cv::Mat>());
+            ca->set(std::make_shared<cv::Mat>(alternativesMat));
+            s.addContainer(ci);
+            s.addContainer(co);
+            s.addContainer(ca);
+
+            s.exec();
+            std::vector<int> output(*co->get(co->size() - 1));
+            ok = output.size() == grid.size() && isSolution(grid.data(), output.data(), 9)
+                 && s.correctedGivens().size() == 1 && s.correctedGivens()[0] == grid;
+            cout << "exec: " << (ok ? "solved with the corrected givens" : "FAILED") << endl;
+        }
+    }
+
+    cout << endl << "Running large Sudoku boards..." << endl << endl;
+    for (int N : {36, 49, 64})
+    {
+        cv::Mat in;
+        if (openInputData("eval/solver/SudokuSolver_" + std::to_string(N) + ".yml", "field", in))
+        {
+            std::vector<int> grid(in), result(grid.size());
+            Sudoku s(N);
+            s.setLogLevel(0);
+            s.setImplementation(Algorithm::CPU);
+
+            Timer timer;
+            size_t solved = s.solveBatch(grid.data(), result.data(), 1);
+            cout << N << "x" << N << ": "
+                 << (!solved ? "not solved" : isSolution(grid.data(), result.data(), N) ? "solved" : "FAILED, wrong solution")
+                 << ", " << s.searchNodes() << " search nodes, " << timer.elapsed() << " ms" << endl;
+        }
+    }
+
 	return true;
 }
 
@@ -97,6 +499,18 @@ bool TestSolver::RunAlgorithm(Algorithm* algo, int iterationsCPU, int iterations
             outputFileName = "_Result_CPU";
             algo->setIterations(iterationsCPU);
         }
+        else if (type == Algorithm::ImplementationType::CPU_EXACT_COVER)
+        {
+            cout << "Computing CPU exact cover...";
+            outputFileName = "_Result_CPU_EC";
+            algo->setIterations(iterationsCPU);
+        }
+        else if (type == Algorithm::ImplementationType::CPU_BITBOARD)
+        {
+            cout << "Computing CPU bitboard...";
+            outputFileName = "_Result_CPU_BB";
+            algo->setIterations(iterationsCPU);
+        }
         else if (type == Algorithm::ImplementationType::OPENCV_CPU)
         {
             cout << "Computing OpenCV CPU...";
@@ -38,6 +38,12 @@ GUIAlgoElement::GUIAlgoElement(QString name, std::unique_ptr<Algorithm> algo, Co
             case Algorithm::ImplementationType::OPENCV_GPU:
                 b->addItem("OCV_GPU");
                 break;
+            case Algorithm::ImplementationType::CPU_EXACT_COVER:
+                b->addItem("CPU_EXACT_COVER");
+                break;
+            case Algorithm::ImplementationType::CPU_BITBOARD:
+                b->addItem("CPU_BITBOARD");
+                break;
             }
         }
 
@@ -56,7 +62,19 @@ GUIAlgoElement::GUIAlgoElement(QString name, std::unique_ptr<Algorithm> algo, Co
         b->setModel(&m_containerList);
         m_argumentWidgets[spec.name()] = b;
 
-        l->addWidget(new QLabel(QString::fromStdString(spec.name())));
+        if (spec.optional())
+        {
+            // optional arguments stay unbound until they are checked
+            QCheckBox* c = new QCheckBox(QString::fromStdString(spec.name()));
+            b->setEnabled(false);
+            connect(c, &QCheckBox::toggled, b, &QComboBox::setEnabled);
+            m_bindWidgets[spec.name()] = c;
+            l->addWidget(c);
+        }
+        else
+        {
+            l->addWidget(new QLabel(QString::fromStdString(spec.name())));
+        }
         l->addWidget(b);
         layout->addItem(l);
     }
@@ -157,6 +175,12 @@ void GUIAlgoElement::prepare(std::map<std::string, std::shared_ptr<Container> >
     {
         QComboBox* box = static_cast<QComboBox*>(m_argumentWidgets[spec.name()]);
 
+        // arguments are passed by position, so the following ones stay unbound as well
+        if (spec.optional() && !static_cast<QCheckBox*>(m_bindWidgets.at(spec.name()))->isChecked())
+        {
+            break;
+        }
+
         auto name = box->currentText().toStdString();
         auto it = containerStack.find(name);
         if (it != containerStack.end())
@@ -207,6 +231,11 @@ void GUIAlgoElement::loadFromFile(cv::FileNode &node)
     {
         QComboBox* box = static_cast<QComboBox*>(m_argumentWidgets[spec.name()]);
         cv::FileNode n = node[spec.name()];
+        if (spec.optional())
+        {
+            // files without the argument leave it unbound
+            static_cast<QCheckBox*>(m_bindWidgets.at(spec.name()))->setChecked(!n.isNone());
+        }
         if (!n.isNone())
         {
             QString label = QString::fromStdString(static_cast<std::string>(n));
@@ -260,6 +289,10 @@ void GUIAlgoElement::saveToFile(cv::FileStorage &fs)
     for (const auto& spec : m_algo->specification())
     {
         QComboBox* box = static_cast<QComboBox*>(m_argumentWidgets[spec.name()]);
+        if (spec.optional() && !static_cast<QCheckBox*>(m_bindWidgets.at(spec.name()))->isChecked())
+        {
+            continue;
+        }
         fs << spec.name() << box->currentText().toStdString();
     }
 
@@ -45,5 +45,7 @@ private:
     QWidget* m_parameterBox;
 
     std::map<std::string, QWidget*> m_argumentWidgets;
+    // check boxes of the optional arguments
+    std::map<std::string, QWidget*> m_bindWidgets;
     std::map<std::string, QWidget*> m_optionWidgets;
 };